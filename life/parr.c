@@ -32,7 +32,17 @@ void initialize_grid(bool *grid, int width, int height);
 int count_neighbors(bool *grid, int x, int y, int width, int height);
 void print_grid(bool *grid, int width, int height);
 void* thread_compute(void *arg);
-void exchange_borders(bool *grid, int width, int local_height, int rank, int size, MPI_Comm comm);
+// Persistent border exchange: MPI_Send_init / MPI_Recv_init once for each
+// of the two grid buffers (they swap every step), MPI_Startall per step
+typedef struct {
+    bool *grid[2];
+    MPI_Request requests[2][4];
+} Halo;
+
+void halo_init(Halo *halo, bool *grid_a, bool *grid_b, int width, int local_height, int rank, int size,
+               MPI_Comm comm);
+void exchange_borders(Halo *halo, bool *grid);
+void halo_free(Halo *halo);
 bool is_grid_stable(bool *current, bool *next, int width, int height);
 
 int main(int argc, char *argv[]) {
@@ -112,13 +122,17 @@ int main(int argc, char *argv[]) {
     // Calculate rows per thread
     int rows_per_thread = local_height / config.thread_count;
     
+    // Border exchange requests for both grid buffers
+    Halo halo;
+    halo_init(&halo, current, next, config.width, local_height, rank, size, MPI_COMM_WORLD);
+    
     // Start timer
     double start_time = MPI_Wtime();
     
     // Main simulation loop
     for (int step = 0; step < config.steps; step++) {
         // Exchange border rows with neighboring processes
-        exchange_borders(current, config.width, local_height, rank, size, MPI_COMM_WORLD);
+        exchange_borders(&halo, current);
         
         // Create and launch threads
         for (int i = 0; i < config.thread_count; i++) {
@@ -196,6 +210,7 @@ int main(int argc, char *argv[]) {
     }
     
     // Clean up
+    halo_free(&halo);
     pthread_barrier_destroy(&barrier);
     free(threads);
     free(thread_data);
@@ -290,20 +305,44 @@ void* thread_compute(void *arg) {
     return NULL;
 }
 
-// Exchange border rows with neighboring processes
-void exchange_borders(bool *grid, int width, int local_height, int rank, int size, MPI_Comm comm) {
+// Set up the border exchange of both grid buffers. Rows sent up carry tag 0
+// and rows sent down tag 1, so with two processes (top == bottom) the
+// messages cannot be matched to the wrong ghost row.
+void halo_init(Halo *halo, bool *grid_a, bool *grid_b, int width, int local_height, int rank, int size,
+               MPI_Comm comm) {
     int top = (rank - 1 + size) % size;
     int bottom = (rank + 1) % size;
     
-    // Send top row to top process and receive bottom ghost row from top process
-    MPI_Sendrecv(grid, width, MPI_C_BOOL, top, 0,
-                 grid - width, width, MPI_C_BOOL, top, 0,
-                 comm, MPI_STATUS_IGNORE);
+    halo->grid[0] = grid_a;
+    halo->grid[1] = grid_b;
     
-    // Send bottom row to bottom process and receive top ghost row from bottom process
-    MPI_Sendrecv(grid + (local_height - 1) * width, width, MPI_C_BOOL, bottom, 0,
-                 grid + local_height * width, width, MPI_C_BOOL, bottom, 0,
-                 comm, MPI_STATUS_IGNORE);
+    for (int b = 0; b < 2; b++) {
+        bool *grid = halo->grid[b];
+        MPI_Request *r = halo->requests[b];
+        
+        // Top row goes to the top process, its bottom row arrives in our top ghost row
+        MPI_Send_init(grid, width, MPI_C_BOOL, top, 0, comm, &r[0]);
+        MPI_Recv_init(grid - width, width, MPI_C_BOOL, top, 1, comm, &r[1]);
+        
+        // Bottom row goes to the bottom process, its top row arrives in our bottom ghost row
+        MPI_Send_init(grid + (local_height - 1) * width, width, MPI_C_BOOL, bottom, 1, comm, &r[2]);
+        MPI_Recv_init(grid + local_height * width, width, MPI_C_BOOL, bottom, 0, comm, &r[3]);
+    }
+}
+
+// Exchange border rows with neighboring processes
+void exchange_borders(Halo *halo, bool *grid) {
+    MPI_Request *r = halo->requests[grid == halo->grid[0] ? 0 : 1];
+    MPI_Startall(4, r);
+    MPI_Waitall(4, r, MPI_STATUSES_IGNORE);
+}
+
+void halo_free(Halo *halo) {
+    for (int b = 0; b < 2; b++) {
+        for (int i = 0; i < 4; i++) {
+            MPI_Request_free(&halo->requests[b][i]);
+        }
+    }
 }
 
 // Check if the grid is stable (no changes between generations)
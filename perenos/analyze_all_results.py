@@ -2,22 +2,35 @@ import pandas as pd
 import matplotlib.pyplot as plt
 import seaborn as sns
 import numpy as np
+import os
 
-# Загрузка данных
-df = pd.read_csv('benchmark_results.csv')
+# Загрузка данных: сводка scaling_bench.py (медиана повторов), если она есть,
+# иначе сырые результаты bench_all.sh
+if os.path.exists('scaling_summary.csv'):
+    df = pd.read_csv('scaling_summary.csv')
+    df = df[df['series'] == 'strong'].rename(columns={'time_median': 'execution_time'})
+else:
+    df = pd.read_csv('benchmark_results.csv')
+    df = df.groupby(['K', 'M', 'processes'], as_index=False)['execution_time'].median()
 
-# Расчет базового времени выполнения (на 1 процессе)
-# Так как в данных нет запусков с 1 процессом, будем оценивать базовое время
-# как время на 2 процессорах * 2 (предполагая идеальное ускорение)
-df['base_time'] = df.apply(lambda row: row['execution_time'] * row['processes'] if row['processes'] == 2 else np.nan, axis=1)
-base_times = df.groupby(['K', 'M'])['base_time'].first().reset_index()
+# Базовое время - реальный запуск на 1 процессе, а не оценка по 2 процессам
+base_times = df[df['processes'] == 1][['K', 'M', 'execution_time']].rename(
+    columns={'execution_time': 'base_time'})
+missing = df[['K', 'M']].drop_duplicates().merge(base_times, how='left')
+missing = missing[missing['base_time'].isna()]
+if len(missing):
+    print('Нет запусков на 1 процессе для (K, M):',
+          ', '.join(f'({k}, {m})' for k, m in zip(missing['K'], missing['M'])),
+          '- ускорение для них не считается')
 
-# Объединяем с основными данными для расчета ускорения и эффективности
-df = pd.merge(df, base_times, on=['K', 'M'], suffixes=('', '_base'))
+df = pd.merge(df, base_times, on=['K', 'M'])
 
-# Расчет ускорения и эффективности
+# Расчет ускорения, эффективности и доли последовательного кода (Карп-Флэтт)
 df['speedup'] = df['base_time'] / df['execution_time']
 df['efficiency'] = (df['speedup'] / df['processes']) * 100
+df['karp_flatt'] = np.where(df['processes'] > 1,
+                            (1 / df['speedup'] - 1 / df['processes']) / (1 - 1 / df['processes']),
+                            np.nan)
 
 # Сохранение расчетных данных
 df.to_csv('performance_metrics.csv', index=False)
@@ -60,5 +73,5 @@ plt.show()
 # Дополнительный анализ - таблица с метриками
 print("\nСводная таблица производительности:")
 summary = df.pivot_table(index=['K', 'M'], columns='processes', 
-                        values=['execution_time', 'speedup', 'efficiency'])
+                        values=['execution_time', 'speedup', 'efficiency', 'karp_flatt'])
 print(summary.to_markdown(floatfmt=".2f"))
\ No newline at end of file
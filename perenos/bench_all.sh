@@ -12,7 +12,7 @@ K_VALUES=(50000 100000 150000)
 M_VALUES=(5000 10000 15000)
 
 # Различные числа процессов
-PROCESSES=(2 4 8 16)
+PROCESSES=(1 2 4 8 16)
 
 # Запуск тестов
 for k in "${K_VALUES[@]}"; do
@@ -0,0 +1,47 @@
+#!/bin/bash
+
+# Ансамбль задач (ensemble.c): перебор параметров одним запуском вместо
+# отдельного mpirun на каждую задачу
+# Использование: ./bench_ensemble.sh [дополнительные key=value для всех задач]
+
+mpicc -O2 -fopenmp ensemble.c -o ensemble -lm
+mpicc -O2 parr_test_full.c -o parr_test -lm
+
+BATCH=ensemble_problems.txt
+PROCESSES=(1 2 4 8 16)
+
+# Перебор: начальное условие x скорость x схема на двух сетках
+echo "# phi a scheme M K" > $BATCH
+for grid in "M=1000 K=2000" "M=4000 K=8000"; do
+    for scheme in cross upwind lax_wendroff; do
+        for phi in gauss sine step; do
+            for a in 0.25 0.5 0.75 1; do
+                echo "$grid scheme=$scheme phi=$phi a=$a" >> $BATCH
+            done
+        done
+    done
+done
+PROBLEMS=$(grep -vc '^#' $BATCH)
+
+RESULTS=ensemble_bench.csv
+echo "processes,problems,ensemble_time,separate_time" > $RESULTS
+
+for p in "${PROCESSES[@]}"; do
+    echo "Ensemble: $PROBLEMS problems, $p processes..."
+    start=$(date +%s.%N)
+    OMP_NUM_THREADS=1 mpirun -np $p ./ensemble $BATCH "$@" > /dev/null
+    ensemble=$(echo "$(date +%s.%N) - $start" | bc)
+
+    # Те же задачи отдельными запусками решателя
+    start=$(date +%s.%N)
+    grep -v '^#' $BATCH | while read line; do
+        mpirun -np $p ./parr_test $line "$@" < /dev/null > /dev/null
+    done
+    separate=$(echo "$(date +%s.%N) - $start" | bc)
+
+    echo "$p,$PROBLEMS,$ensemble,$separate" >> $RESULTS
+    sleep 1
+done
+
+# Ошибки каждой задачи последнего запуска - в ensemble_results.csv
+echo "Результаты сохранены в $RESULTS"
@@ -0,0 +1,28 @@
+#!/bin/bash
+
+# Смешанная точность (mixed_precision.c): время и ошибка хранения слоёв во
+# float32 и float32 с компенсацией относительно float64 на разных сетках
+# Использование: ./bench_mixed.sh [дополнительные key=value]
+
+mpicc -O2 mixed_precision.c -o mixed_precision -lm
+
+K_VALUES=(20000 40000)
+M_VALUES=(100000 1000000)
+PROCESSES=(1 2 4 8)
+
+# Отчёт каждого запуска дописывается в mixed_precision.csv
+rm -f mixed_precision.csv
+
+for k in "${K_VALUES[@]}"; do
+    for m in "${M_VALUES[@]}"; do
+        for p in "${PROCESSES[@]}"; do
+            for precision in float kahan; do
+                echo "Running K=$k, M=$m, precision=$precision with $p processes..."
+                mpirun -np $p ./mixed_precision $k $m precision=$precision "$@"
+                sleep 1
+            done
+        done
+    done
+done
+
+echo "Результаты сохранены в mixed_precision.csv"
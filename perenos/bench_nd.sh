@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# Сильная и слабая масштабируемость многомерного решателя (parr_nd.c)
+# Использование: ./bench_nd.sh [dim]
+
+mpicc -O2 parr_nd.c -o parr_nd -lm
+
+DIM=${1:-2}
+K=1000
+PROCESSES=(1 2 4 8 16)
+
+# Сильная масштабируемость: фиксированная сетка
+if [ "$DIM" -eq 3 ]; then M_STRONG=200; else M_STRONG=4000; fi
+
+# Слабая масштабируемость: фиксированное число точек на процесс
+if [ "$DIM" -eq 3 ]; then M_WEAK_BASE=100; else M_WEAK_BASE=1000; fi
+
+RESULTS=scaling_results_nd.csv
+echo "series,dim,K,M,processes,execution_time" > $RESULTS
+
+for p in "${PROCESSES[@]}"; do
+    echo "Strong scaling: dim=$DIM, M=$M_STRONG, $p processes..."
+    line=$(mpirun -np $p ./parr_nd K=$K M=$M_STRONG dim=$DIM | tail -n 1)
+    echo "strong,$line" >> $RESULTS
+    sleep 1
+done
+
+for p in "${PROCESSES[@]}"; do
+    # Сторона сетки растет как p^(1/dim)
+    M=$(awk -v m=$M_WEAK_BASE -v p=$p -v d=$DIM 'BEGIN { printf "%d", m * p ^ (1 / d) }')
+    echo "Weak scaling: dim=$DIM, M=$M, $p processes..."
+    line=$(mpirun -np $p ./parr_nd K=$K M=$M dim=$DIM | tail -n 1)
+    echo "weak,$line" >> $RESULTS
+    sleep 1
+done
+
+echo "Benchmarking completed. Results saved to $RESULTS"
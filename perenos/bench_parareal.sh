@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Parareal (parareal.c): число итераций и ускорение в зависимости от числа
+# временных отрезков на длинном интервале T
+# Использование: ./bench_parareal.sh [дополнительные key=value]
+
+mpicc -O2 parareal.c -o parareal -lm
+
+K=40000
+M=2000
+PROCESSES=(1 2 4 8 16)
+PROBLEM="T=8 X=8 phi_center=1 $*"
+
+RESULTS=parareal_results.csv
+echo "processes,iterations,serial_time,parareal_time,speedup" > $RESULTS
+
+for p in "${PROCESSES[@]}"; do
+    echo "Parareal: K=$K, M=$M, $p processes..."
+    output=$(mpirun -np $p ./parareal K=$K M=$M $PROBLEM)
+    serial=$(echo "$output" | awk '/^Serial fine time/ { print $4 }')
+    total=$(echo "$output" | sed -n 's/^Total execution time: \([0-9.]*\) seconds (parareal, \([0-9]*\) iterations.*/\1 \2/p')
+    set -- $total
+    echo "$p,$2,$serial,$1,$(awk -v s=$serial -v t=$1 'BEGIN { printf "%.3f", s / t }')" >> $RESULTS
+
+    # История сходимости каждого запуска сохраняется отдельно
+    mv parareal_convergence.csv parareal_convergence_p$p.csv
+    sleep 1
+done
+
+echo "Результаты сохранены в $RESULTS"
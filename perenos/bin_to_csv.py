@@ -0,0 +1,40 @@
+import struct
+import sys
+
+import numpy as np
+
+# Converts the binary snapshot file written by parr_test_full.c
+# (./parr_test K M snapshots bin) to the CSV layout used by plot_solution_p.py
+#
+# Usage: python3 bin_to_csv.py [input.bin] [output.csv] [number_of_snapshots]
+
+HEADER_FORMAT = '<8sii3q3d'
+MAGIC = b'TRSNAP01'
+
+input_path = sys.argv[1] if len(sys.argv) > 1 else 'transport_solution_mpi.bin'
+output_path = sys.argv[2] if len(sys.argv) > 2 else 'transport_solution_multiple_mpi.csv'
+
+with open(input_path, 'rb') as fp:
+    raw = fp.read(struct.calcsize(HEADER_FORMAT))
+    magic, version, header_bytes, npoints, nsnapshots, capacity, h, tau, a = \
+        struct.unpack(HEADER_FORMAT, raw)
+
+    if magic != MAGIC:
+        sys.exit(f'{input_path}: not a transport snapshot file')
+
+    fp.seek(header_bytes)
+    times = np.fromfile(fp, dtype='<f8', count=capacity)
+    data = np.fromfile(fp, dtype='<f8', count=nsnapshots * npoints).reshape(nsnapshots, npoints)
+
+# By default every stored snapshot is converted
+count = int(sys.argv[3]) if len(sys.argv) > 3 else nsnapshots
+count = min(count, nsnapshots)
+
+print(f'{input_path}: {npoints} points, {nsnapshots} snapshots, h={h:g}, tau={tau:g}, a={a:g}')
+print('Snapshot times: ' + ', '.join(f'{t:g}' for t in times[:nsnapshots]))
+
+table = np.column_stack([np.arange(npoints) * h, data[:count].T])
+header = 'x,' + ','.join(f't_{s}' for s in range(count))
+np.savetxt(output_path, table, fmt='%f', delimiter=',', header=header, comments='')
+
+print(f'Solution saved to {output_path}')
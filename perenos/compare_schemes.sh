@@ -0,0 +1,20 @@
+#!/bin/bash
+
+# Сравнение разностных схем по времени счета при одинаковой сетке по x:
+# явные схемы ограничены условием Куранта, Кранк-Николсон - нет
+
+mpicc parr_test_full.c -o parr_test -lm
+
+M=20000
+PROCS=4
+
+for scheme in cross upwind lax_wendroff; do
+    echo "Scheme $scheme, K=$M (Courant 1)"
+    mpirun -np $PROCS ./parr_test K=$M M=$M scheme=$scheme | grep "Total execution time"
+done
+
+# Неявная схема: шаг по времени в 4, 16 и 64 раза больше
+for K in $((M / 4)) $((M / 16)) $((M / 64)); do
+    echo "Scheme crank_nicolson, K=$K (Courant $((M / K)))"
+    mpirun -np $PROCS ./parr_test K=$K M=$M scheme=crank_nicolson | grep "Total execution time"
+done
@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include "transport_problem.h"
+#include "transport_schemes.h"
+
+// Ensemble mode: many independent 1D transport problems in one launch
+//
+// Every line of the batch file is one problem, given as key=value pairs
+// on top of the settings from the command line (see transport_problem.h):
+//
+//     # phi / a sweep on two grids
+//     M=1000 K=2000 phi=gauss a=1
+//     M=1000 K=2000 phi=sine a=0.5
+//     M=4000 K=8000 phi=step a=0.8 scheme=upwind
+//
+// Problems with the same scheme, K and M are packed ENSEMBLE_LANES at a
+// time into one interleaved layer u[i * LANES + lane], so a single stencil
+// sweep advances all of them with SIMD. T, X, a, phi, psi and f may differ
+// between lanes: Courant numbers, steps and boundary values are per lane.
+//
+// The packs form a work queue shared by all ranks: a counter in an MPI
+// window on rank 0, taken with MPI_Fetch_and_op by the OpenMP threads of
+// every rank, largest packs first. Each problem is solved like
+// parr_test_full.c on one process (same kernels, zero-gradient outflow),
+// and its error against the exact solution and its share of the pack time
+// go to ensemble_results.csv.
+//
+// Usage: mpirun -np 4 ./ensemble problems.txt [key=value ...]
+// Build: mpicc -O2 -fopenmp ensemble.c -o ensemble -lm
+
+#define ENSEMBLE_LANES 4
+#define ENSEMBLE_RESULTS "ensemble_results.csv"
+#define MAX_PROBLEMS 100000
+
+typedef struct {
+    int first;             // index into the sorted problem order
+    int count;             // lanes in use
+    double cost;           // K * M
+} Pack;
+
+// Error norms and time of one problem. Only doubles, so rank 0 can collect
+// all results with one MPI_Reduce over RESULT_DOUBLES * count values; the
+// rank that solved a problem is kept in a separate int array
+typedef struct {
+    double l2, linf;       // NaN without an exact solution
+    double seconds;        // pack time divided by the lanes in use
+} Result;
+
+#define RESULT_DOUBLES ((int)(sizeof(Result) / sizeof(double)))
+_Static_assert(sizeof(Result) == 3 * sizeof(double), "Result must hold only doubles");
+
+// Read the batch file: one problem per non-empty line, '#' starts a comment
+int read_batch(const char *path, const TransportConfig *base, TransportConfig **out) {
+    FILE *fp = fopen(path, "r");
+    char line[4 * PROBLEM_LINE_MAX];
+    int count = 0, line_no = 0;
+    TransportConfig *problems = NULL;
+
+    if (!fp) {
+        fprintf(stderr, "Cannot open batch file %s\n", path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+
+        TransportConfig cfg = *base;
+        int tokens = 0;
+        for (char *tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+            char *eq = strchr(tok, '=');
+            if (!eq) {
+                fprintf(stderr, "%s:%d: expected key=value, got '%s'\n", path, line_no, tok);
+                fclose(fp);
+                free(problems);
+                return -1;
+            }
+            *eq = '\0';
+            if (problem_set(&cfg, tok, eq + 1) != 0) {
+                fprintf(stderr, "%s:%d: bad setting\n", path, line_no);
+                fclose(fp);
+                free(problems);
+                return -1;
+            }
+            tokens++;
+        }
+        if (tokens == 0) {
+            continue;
+        }
+        if (cfg.K < 1 || cfg.M < 2 || cfg.scheme == SCHEME_CRANK_NICOLSON || count == MAX_PROBLEMS) {
+            fprintf(stderr, "%s:%d: need K >= 1, M >= 2 and an explicit scheme\n", path, line_no);
+            fclose(fp);
+            free(problems);
+            return -1;
+        }
+
+        if ((count & (count - 1)) == 0) {
+            problems = (TransportConfig *)realloc(problems, (count ? 2 * count : 1) * sizeof(TransportConfig));
+        }
+        problems[count++] = cfg;
+    }
+
+    fclose(fp);
+    *out = problems;
+    return count;
+}
+
+// Order that puts packable problems next to each other
+static const TransportConfig *sort_problems;
+
+static int compare_problems(const void *pa, const void *pb) {
+    const TransportConfig *a = &sort_problems[*(const int *)pa];
+    const TransportConfig *b = &sort_problems[*(const int *)pb];
+    if (a->scheme != b->scheme) return a->scheme - b->scheme;
+    if (a->M != b->M) return a->M - b->M;
+    if (a->K != b->K) return a->K - b->K;
+    return *(const int *)pa - *(const int *)pb;
+}
+
+static int compare_packs(const void *pa, const void *pb) {
+    double ca = ((const Pack *)pa)->cost, cb = ((const Pack *)pb)->cost;
+    return (ca < cb) - (ca > cb);
+}
+
+// Solve the problems order[0 .. count-1] (same scheme, K, M) together.
+// Unused lanes repeat the first problem and are ignored.
+void solve_pack(const TransportConfig *problems, const int *order, int count, Result *results,
+                int *solved_by, int rank) {
+    const int L = ENSEMBLE_LANES;
+    const TransportConfig *lane[ENSEMBLE_LANES];
+    for (int l = 0; l < L; l++) {
+        lane[l] = &problems[order[l < count ? l : 0]];
+    }
+
+    int K = lane[0]->K, M = lane[0]->M;
+    SchemeKind scheme = lane[0]->scheme;
+    int n = M + 1;
+
+    double tau[ENSEMBLE_LANES], h[ENSEMBLE_LANES], c[ENSEMBLE_LANES], s[ENSEMBLE_LANES];
+    int steady = 0, unsteady = 0;
+    for (int l = 0; l < L; l++) {
+        tau[l] = lane[l]->t_max / K;
+        h[l] = lane[l]->x_max / M;
+        if (lane[l]->f != SOURCE_ZERO) {
+            if (problem_source_is_steady(lane[l])) {
+                steady = 1;
+            } else {
+                unsteady = 1;
+            }
+        }
+    }
+
+    double *prev = (double *)malloc((size_t)n * L * sizeof(double));
+    double *curr = (double *)malloc((size_t)n * L * sizeof(double));
+    double *next = (double *)malloc((size_t)n * L * sizeof(double));
+    double *source = steady ? (double *)calloc((size_t)n * L, sizeof(double)) : NULL;
+
+    double start = omp_get_wtime();
+
+    // Initial layers and the steady source tables, interleaved
+    for (int l = 0; l < L; l++) {
+        for (int i = 0; i < n; i++) {
+            curr[i * L + l] = problem_phi(lane[l], i * h[l]);
+        }
+        curr[l] = problem_psi(lane[l], 0.0);
+        if (steady && problem_source_is_steady(lane[l])) {
+            for (int i = 0; i < n; i++) {
+                source[i * L + l] = problem_f(lane[l], 0.0, i * h[l]);
+            }
+        }
+    }
+
+    for (int k = 0; k < K; k++) {
+        int leapfrog = (scheme == SCHEME_CROSS && k > 0);
+
+        // Per lane Courant number and source weight of this step
+        for (int l = 0; l < L; l++) {
+            double t = k * tau[l];
+            if (scheme == SCHEME_CROSS) {
+                c[l] = leapfrog ? problem_velocity(lane[l], t) * tau[l] / h[l]
+                                : problem_velocity(lane[l], t + 0.5 * tau[l]) * tau[l] / (2 * h[l]);
+                s[l] = leapfrog ? 2 * tau[l] : tau[l];
+            } else {
+                c[l] = problem_velocity(lane[l], t + 0.5 * tau[l]) * tau[l] / h[l];
+                s[l] = tau[l];
+            }
+        }
+
+        const double *base = leapfrog ? prev : curr;
+        switch (scheme) {
+            case SCHEME_CROSS:
+                for (int i = 1; i < M; i++) {
+                    #pragma omp simd
+                    for (int l = 0; l < L; l++) {
+                        next[i*L + l] = base[i*L + l] - c[l] * (curr[(i+1)*L + l] - curr[(i-1)*L + l]);
+                    }
+                }
+                break;
+            case SCHEME_UPWIND:
+                for (int i = 1; i < M; i++) {
+                    #pragma omp simd
+                    for (int l = 0; l < L; l++) {
+                        double u = curr[i*L + l];
+                        next[i*L + l] = (c[l] >= 0.0) ? u - c[l] * (u - curr[(i-1)*L + l])
+                                                      : u - c[l] * (curr[(i+1)*L + l] - u);
+                    }
+                }
+                break;
+            default:   // Lax-Wendroff
+                for (int i = 1; i < M; i++) {
+                    #pragma omp simd
+                    for (int l = 0; l < L; l++) {
+                        double um = curr[(i-1)*L + l], u = curr[i*L + l], up = curr[(i+1)*L + l];
+                        next[i*L + l] = u - 0.5 * c[l] * (up - um) + 0.5 * c[l] * c[l] * (up - 2.0 * u + um);
+                    }
+                }
+                break;
+        }
+
+        // Sources: steady ones from the table, the rest point by point
+        if (steady) {
+            for (int i = 1; i < M; i++) {
+                #pragma omp simd
+                for (int l = 0; l < L; l++) {
+                    next[i*L + l] += s[l] * source[i*L + l];
+                }
+            }
+        }
+        if (unsteady) {
+            for (int l = 0; l < L; l++) {
+                if (lane[l]->f == SOURCE_ZERO || problem_source_is_steady(lane[l])) {
+                    continue;
+                }
+                // Lax-Wendroff takes the source at the half step
+                double t = k * tau[l] + ((scheme == SCHEME_LAX_WENDROFF) ? 0.5 * tau[l] : 0.0);
+                for (int i = 1; i < M; i++) {
+                    next[i*L + l] += s[l] * problem_f(lane[l], t, i * h[l]);
+                }
+            }
+        }
+
+        // Inflow at x=0, zero-gradient outflow at x=X
+        for (int l = 0; l < L; l++) {
+            next[l] = problem_psi(lane[l], (k + 1) * tau[l]);
+            next[M*L + l] = next[(M-1)*L + l];
+        }
+
+        double *temp = prev;
+        prev = curr;
+        curr = next;
+        next = temp;
+    }
+
+    double seconds = (omp_get_wtime() - start) / count;
+
+    // Errors at t = T, one lane at a time
+    double *u = next;
+    for (int l = 0; l < count; l++) {
+        for (int i = 0; i < n; i++) {
+            u[i] = curr[i*L + l];
+        }
+        Result *r = &results[order[l]];
+        r->l2 = 0.0;
+        r->linf = 0.0;
+        int have_exact = problem_error(lane[l], K * tau[l], 0, n, h[l], u, &r->l2, &r->linf);
+        r->l2 = have_exact ? sqrt(h[l] * r->l2) : NAN;
+        r->linf = have_exact ? r->linf : NAN;
+        r->seconds = seconds;
+        solved_by[order[l]] = rank;
+    }
+
+    free(prev);
+    free(curr);
+    free(next);
+    free(source);
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size, provided;
+    TransportConfig base;
+    TransportConfig *problems = NULL;
+    int count = 0;
+
+    // Threads take work from the queue one at a time (omp critical)
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (provided < MPI_THREAD_SERIALIZED) {
+        omp_set_num_threads(1);
+    }
+
+    // Rank 0 reads the batch and shares it with everybody
+    if (rank == 0) {
+        problem_defaults(&base, 1000, 1000);
+        if (argc < 2 || strchr(argv[1], '=') != NULL ||
+            problem_parse_args(&base, argc - 1, argv + 1, NULL) != 0 ||
+            (count = read_batch(argv[1], &base, &problems)) < 0) {
+            printf("Usage: %s batch_file [key=value ...]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        problems = (TransportConfig *)malloc(count * sizeof(TransportConfig));
+    }
+    MPI_Bcast(problems, count * sizeof(TransportConfig), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    // Packs of up to ENSEMBLE_LANES problems with the same scheme, K and M,
+    // the most expensive first so the queue ends with small ones
+    int *order = (int *)malloc(count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    sort_problems = problems;
+    qsort(order, count, sizeof(int), compare_problems);
+
+    Pack *packs = (Pack *)malloc(count * sizeof(Pack));
+    int num_packs = 0;
+    for (int i = 0; i < count; ) {
+        const TransportConfig *p = &problems[order[i]];
+        int j = i + 1;
+        while (j < count && j - i < ENSEMBLE_LANES &&
+               problems[order[j]].scheme == p->scheme && problems[order[j]].M == p->M &&
+               problems[order[j]].K == p->K) {
+            j++;
+        }
+        packs[num_packs].first = i;
+        packs[num_packs].count = j - i;
+        packs[num_packs].cost = (double)p->K * p->M;
+        num_packs++;
+        i = j;
+    }
+    qsort(packs, num_packs, sizeof(Pack), compare_packs);
+
+    // Work queue: next pack index in a window on rank 0
+    int *queue_head;
+    MPI_Win queue;
+    MPI_Win_allocate((rank == 0) ? sizeof(int) : 0, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD,
+                     &queue_head, &queue);
+    if (rank == 0) {
+        *queue_head = 0;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    Result *results = (Result *)calloc(count, sizeof(Result));
+    int *solved_by = (int *)malloc(count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        solved_by[i] = -1;
+    }
+    int packs_done = 0;
+
+    double start_time = MPI_Wtime();
+
+    #pragma omp parallel reduction(+:packs_done)
+    {
+        const int one = 1;
+        for (;;) {
+            int index;
+            #pragma omp critical(queue)
+            {
+                MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, queue);
+                MPI_Fetch_and_op(&one, &index, MPI_INT, 0, 0, MPI_SUM, queue);
+                MPI_Win_unlock(0, queue);
+            }
+            if (index >= num_packs) {
+                break;
+            }
+            solve_pack(problems, &order[packs[index].first], packs[index].count, results,
+                       solved_by, rank);
+            packs_done++;
+        }
+    }
+
+    double local_time = MPI_Wtime() - start_time;
+
+    // Every problem was solved by exactly one rank, the others hold zeros
+    // (and -1 in solved_by)
+    Result *all = (rank == 0) ? (Result *)calloc(count, sizeof(Result)) : NULL;
+    int *all_solved_by = (rank == 0) ? (int *)malloc(count * sizeof(int)) : NULL;
+    MPI_Reduce(results, all, count * RESULT_DOUBLES, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(solved_by, all_solved_by, count, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    double total_time;
+    int total_packs;
+    MPI_Reduce(&local_time, &total_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&packs_done, &total_packs, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double solver_time = 0.0;
+        FILE *fp = fopen(ENSEMBLE_RESULTS, "w");
+        if (!fp) {
+            printf("Error opening output file\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        fprintf(fp, "id,scheme,K,M,a,T,X,phi,psi,f,l2,linf,seconds,rank\n");
+        for (int i = 0; i < count; i++) {
+            const TransportConfig *p = &problems[i];
+            fprintf(fp, "%d,%s,%d,%d,%g,%g,%g,%s,%s,%s,%.10e,%.10e,%.6f,%d\n", i, scheme_names[p->scheme],
+                    p->K, p->M, p->a, p->t_max, p->x_max, phi_names[p->phi], psi_names[p->psi],
+                    source_names[p->f], all[i].l2, all[i].linf, all[i].seconds, all_solved_by[i]);
+            solver_time += all[i].seconds;
+        }
+        fclose(fp);
+
+        printf("Ensemble: %d problems in %d packs of up to %d lanes, %d ranks x %d threads\n",
+               count, total_packs, ENSEMBLE_LANES, size, omp_get_max_threads());
+        printf("Solver time %.4f s, total execution time: %.4f seconds\n", solver_time, total_time);
+        printf("Results saved to %s\n", ENSEMBLE_RESULTS);
+        free(all);
+        free(all_solved_by);
+    }
+
+    MPI_Win_free(&queue);
+    free(results);
+    free(solved_by);
+    free(packs);
+    free(order);
+    free(problems);
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "transport_problem.h"
+#include "transport_schemes.h"
+#include "transport_stepper.h"
+
+// Mixed-precision cross scheme for the 1D transport equation
+//
+// The cross scheme streams three layers per step and does two flops per
+// point, so its speed is set by memory bandwidth. This driver runs the same
+// distributed problem twice in one launch:
+//
+//   double  float64 layers, the reference (as in parr_test_full.c)
+//   float   float32 layers, every update computed in float64 and rounded
+//           once when it is stored; halo messages carry floats
+//   kahan   float32 layers plus a float32 compensation array holding the
+//           rounding residual of every stored value. The leapfrog update
+//           u[k+1] = u[k-1] + d adds the increment d to hi + lo, so storing
+//           the result loses nothing; d itself (and the halo) is computed
+//           from the float32 part only. This removes the rounding of the
+//           stored sum, not the float32 error of the stencil inputs
+//
+// and reports, for the float64 run and the selected precision=float|kahan:
+// time, streamed bytes per point and step, error against the exact
+// solution and the difference to the float64 run. One line per run is
+// appended to mixed_precision.csv.
+//
+// Usage: mpirun -np 4 ./mixed_precision [K M] [precision=float|kahan] [key=value ...]
+
+#define DEFAULT_K 20000
+#define DEFAULT_M 100000
+#define REPORT_FILE "mixed_precision.csv"
+
+// Bytes loaded and stored per point and step with the curr stencil
+// reused from cache: prev + curr + next, for kahan prev and next twice
+static const int bytes_per_point[PRECISION_COUNT] = {24, 12, 20};
+
+typedef struct {
+    int M;
+    int local_start;      // global index of the first owned point
+    int local_count;      // owned points, stored at 1 .. local_count
+    int left, right;      // neighbour ranks or MPI_PROC_NULL
+    double h, tau;
+    double *source;       // steady source at the owned points, NULL otherwise
+} Grid;
+
+typedef struct {
+    double seconds;
+    double l2, linf;      // against the exact solution
+    double l2_ref, linf_ref;  // against the float64 run
+    int have_exact;
+} RunStats;
+
+// Ghost values from both neighbours: u[0] and u[local_count + 1]
+static void exchange_ghosts(void *u, MPI_Datatype type, size_t elem, const Grid *g) {
+    char *p = (char *)u;
+    int n = g->local_count;
+    MPI_Sendrecv(p + n * elem, 1, type, g->right, 0,
+                 p, 1, type, g->left, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(p + 1 * elem, 1, type, g->left, 1,
+                 p + (n + 1) * elem, 1, type, g->right, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+// Source contribution s * f(t, x) at local point j
+static inline double source_term(const TransportConfig *cfg, const Grid *g, int j, double s, double t) {
+    if (cfg->f == SOURCE_ZERO) {
+        return 0.0;
+    }
+    if (g->source != NULL) {
+        return s * g->source[j];
+    }
+    return s * problem_f(cfg, t, (g->local_start + j - 1) * g->h);
+}
+
+// Points updated by the scheme: global 1 .. M-1
+static void update_range(const Grid *g, int *first, int *last) {
+    *first = (g->local_start == 0) ? 2 : 1;
+    *last = g->local_count + 1;
+    if (g->local_start + g->local_count - 1 == g->M) {
+        (*last)--;
+    }
+}
+
+void run_double(const TransportConfig *cfg, const Grid *g, double *out) {
+    int n = g->local_count + 2, first, last;
+    double *prev = (double *)calloc(n, sizeof(double));
+    double *curr = (double *)calloc(n, sizeof(double));
+    double *next = (double *)calloc(n, sizeof(double));
+    double c = cfg->a * g->tau / g->h;
+
+    update_range(g, &first, &last);
+    problem_tabulate_phi(cfg, g->local_start, g->local_count, g->h, &curr[1]);
+    if (g->local_start == 0) {
+        curr[1] = problem_psi(cfg, 0.0);
+    }
+
+    for (int k = 0; k < cfg->K; k++) {
+        double t = k * g->tau;
+        exchange_ghosts(curr, MPI_DOUBLE, sizeof(double), g);
+        // The kernel of parr_test_full.c, so the reference is that solver
+        if (k == 0) {
+            central_step(cfg, next, curr, curr, g->source, first, last, g->local_start - 1,
+                         0.5 * c, g->tau, t, g->h);
+        } else {
+            central_step(cfg, next, prev, curr, g->source, first, last, g->local_start - 1,
+                         c, 2 * g->tau, t, g->h);
+        }
+        if (g->local_start == 0) {
+            next[1] = problem_psi(cfg, t + g->tau);
+        }
+        if (last == g->local_count) {
+            next[last] = next[last - 1];
+        }
+
+        double *temp = prev;
+        prev = curr;
+        curr = next;
+        next = temp;
+    }
+
+    memcpy(out, &curr[1], g->local_count * sizeof(double));
+    free(prev);
+    free(curr);
+    free(next);
+}
+
+void run_float(const TransportConfig *cfg, const Grid *g, double *out) {
+    int n = g->local_count + 2, first, last;
+    float *prev = (float *)calloc(n, sizeof(float));
+    float *curr = (float *)calloc(n, sizeof(float));
+    float *next = (float *)calloc(n, sizeof(float));
+    double c = cfg->a * g->tau / g->h;
+
+    update_range(g, &first, &last);
+    for (int j = 1; j <= g->local_count; j++) {
+        curr[j] = (float)problem_phi(cfg, (g->local_start + j - 1) * g->h);
+    }
+    if (g->local_start == 0) {
+        curr[1] = (float)problem_psi(cfg, 0.0);
+    }
+
+    for (int k = 0; k < cfg->K; k++) {
+        double t = k * g->tau;
+        exchange_ghosts(curr, MPI_FLOAT, sizeof(float), g);
+        if (k == 0) {
+            for (int j = first; j < last; j++) {
+                next[j] = (float)(curr[j] - 0.5 * c * ((double)curr[j+1] - curr[j-1])
+                                  + source_term(cfg, g, j, g->tau, t));
+            }
+        } else {
+            for (int j = first; j < last; j++) {
+                next[j] = (float)(prev[j] - c * ((double)curr[j+1] - curr[j-1])
+                                  + source_term(cfg, g, j, 2 * g->tau, t));
+            }
+        }
+        if (g->local_start == 0) {
+            next[1] = (float)problem_psi(cfg, t + g->tau);
+        }
+        if (last == g->local_count) {
+            next[last] = next[last - 1];
+        }
+
+        float *temp = prev;
+        prev = curr;
+        curr = next;
+        next = temp;
+    }
+
+    for (int j = 0; j < g->local_count; j++) {
+        out[j] = curr[j + 1];
+    }
+    free(prev);
+    free(curr);
+    free(next);
+}
+
+// Store v as hi + lo, both float32
+static inline void split_store(double v, float *hi, float *lo) {
+    *hi = (float)v;
+    *lo = (float)(v - *hi);
+}
+
+void run_kahan(const TransportConfig *cfg, const Grid *g, double *out) {
+    int n = g->local_count + 2, first, last;
+    float *hi[3], *lo[3];
+    for (int i = 0; i < 3; i++) {
+        hi[i] = (float *)calloc(n, sizeof(float));
+        lo[i] = (float *)calloc(n, sizeof(float));
+    }
+    float *prev = hi[0], *curr = hi[1], *next = hi[2];
+    float *prev_lo = lo[0], *curr_lo = lo[1], *next_lo = lo[2];
+    double c = cfg->a * g->tau / g->h;
+
+    update_range(g, &first, &last);
+    for (int j = 1; j <= g->local_count; j++) {
+        split_store(problem_phi(cfg, (g->local_start + j - 1) * g->h), &curr[j], &curr_lo[j]);
+    }
+    if (g->local_start == 0) {
+        split_store(problem_psi(cfg, 0.0), &curr[1], &curr_lo[1]);
+    }
+
+    for (int k = 0; k < cfg->K; k++) {
+        double t = k * g->tau;
+        exchange_ghosts(curr, MPI_FLOAT, sizeof(float), g);
+        if (k == 0) {
+            for (int j = first; j < last; j++) {
+                double d = -0.5 * c * ((double)curr[j+1] - curr[j-1]) + source_term(cfg, g, j, g->tau, t);
+                split_store(curr[j] + (curr_lo[j] + d), &next[j], &next_lo[j]);
+            }
+        } else {
+            for (int j = first; j < last; j++) {
+                double d = -c * ((double)curr[j+1] - curr[j-1]) + source_term(cfg, g, j, 2 * g->tau, t);
+                split_store(prev[j] + (prev_lo[j] + d), &next[j], &next_lo[j]);
+            }
+        }
+        if (g->local_start == 0) {
+            split_store(problem_psi(cfg, t + g->tau), &next[1], &next_lo[1]);
+        }
+        if (last == g->local_count) {
+            next[last] = next[last - 1];
+            next_lo[last] = next_lo[last - 1];
+        }
+
+        float *temp = prev;
+        prev = curr;
+        curr = next;
+        next = temp;
+        temp = prev_lo;
+        prev_lo = curr_lo;
+        curr_lo = next_lo;
+        next_lo = temp;
+    }
+
+    for (int j = 0; j < g->local_count; j++) {
+        out[j] = (double)curr[j + 1] + curr_lo[j + 1];
+    }
+    for (int i = 0; i < 3; i++) {
+        free(hi[i]);
+        free(lo[i]);
+    }
+}
+
+// Run one precision and collect its statistics; reference is the float64
+// result of the owned points or NULL while it is being computed
+void run_precision(const TransportConfig *cfg, const Grid *g, PrecisionKind precision,
+                   const double *reference, double *out, RunStats *st) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_time = MPI_Wtime();
+    switch (precision) {
+        case PRECISION_DOUBLE: run_double(cfg, g, out); break;
+        case PRECISION_FLOAT:  run_float(cfg, g, out); break;
+        default:               run_kahan(cfg, g, out); break;
+    }
+    double elapsed = MPI_Wtime() - start_time;
+    MPI_Reduce(&elapsed, &st->seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    // Sums of squares and maxima: exact solution, float64 run
+    double local[4] = {0.0, 0.0, 0.0, 0.0}, global[4];
+    int have_exact = problem_error(cfg, cfg->K * g->tau, g->local_start, g->local_count, g->h, out,
+                                   &local[0], &local[1]);
+    if (reference != NULL) {
+        for (int j = 0; j < g->local_count; j++) {
+            double e = fabs(out[j] - reference[j]);
+            local[2] += e * e;
+            if (!(e <= local[3])) {
+                local[3] = e;
+            }
+        }
+    }
+    MPI_Reduce(&local[0], &global[0], 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local[1], &global[1], 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local[2], &global[2], 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local[3], &global[3], 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    st->have_exact = have_exact;
+    st->l2 = sqrt(g->h * global[0]);
+    st->linf = global[1];
+    st->l2_ref = sqrt(g->h * global[2]);
+    st->linf_ref = global[3];
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size;
+    TransportConfig cfg;
+    const char *positional[] = {"K", "M", NULL};
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Parse the problem on rank 0 and share it with everybody
+    if (rank == 0) {
+        problem_defaults(&cfg, DEFAULT_K, DEFAULT_M);
+        if (problem_parse_args(&cfg, argc, argv, positional) != 0) {
+            printf("Usage: %s [K M] [precision=float|kahan] [key=value ...] [config=file]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (cfg.scheme != SCHEME_CROSS || cfg.a_amp != 0.0 || cfg.M + 1 < 2 * size) {
+            printf("Only the cross scheme with a constant velocity and M + 1 >= 2 * processes\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        problem_print(&cfg);
+    }
+    MPI_Bcast(&cfg, sizeof(cfg), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    // With cfl > 0 both precisions run the same stable step, chosen once
+    int M = cfg.M;
+    Grid g;
+    g.M = M;
+    g.h = cfg.x_max / M;
+    int K = cfg.K = stepper_step_count(&cfg, g.h);
+    g.tau = cfg.t_max / K;
+
+    if (rank == 0) {
+        if (cfg.cfl <= 0.0 && fabs(cfg.a * g.tau / g.h) > scheme_info[SCHEME_CROSS].cfl_limit) {
+            printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", fabs(cfg.a * g.tau / g.h));
+        }
+        if (cfg.cfl > 0.0) {
+            if (cfg.cfl > scheme_info[SCHEME_CROSS].cfl_limit) {
+                printf("Warning: cfl=%g is above the stability limit %g of scheme cross\n",
+                       cfg.cfl, scheme_info[SCHEME_CROSS].cfl_limit);
+            }
+            printf("Adaptive step: %d steps, tau %.4e (cfl %g)\n", K, g.tau, cfg.cfl);
+        }
+    }
+
+    // Block distribution of the M + 1 grid points
+    int n = M + 1;
+    g.local_count = n / size + ((rank < n % size) ? 1 : 0);
+    g.local_start = rank * (n / size) + ((rank < n % size) ? rank : n % size);
+    g.left = (rank > 0) ? rank - 1 : MPI_PROC_NULL;
+    g.right = (rank < size - 1) ? rank + 1 : MPI_PROC_NULL;
+
+    // Steady source at the owned points, index 1 .. local_count as the layers
+    g.source = NULL;
+    if (problem_source_is_steady(&cfg)) {
+        g.source = (double *)calloc(g.local_count + 2, sizeof(double));
+        problem_tabulate_source(&cfg, g.local_start, g.local_count, g.h, &g.source[1]);
+    }
+
+    double *reference = (double *)malloc(g.local_count * sizeof(double));
+    double *result = (double *)malloc(g.local_count * sizeof(double));
+
+    PrecisionKind runs[2] = {PRECISION_DOUBLE, cfg.precision};
+    int num_runs = (cfg.precision == PRECISION_DOUBLE) ? 1 : 2;
+    RunStats stats[2];
+
+    run_precision(&cfg, &g, PRECISION_DOUBLE, NULL, reference, &stats[0]);
+    if (num_runs > 1) {
+        run_precision(&cfg, &g, cfg.precision, reference, result, &stats[1]);
+    }
+
+    // Report
+    if (rank == 0) {
+        FILE *fp = fopen(REPORT_FILE, "a");
+        if (fp && ftell(fp) == 0) {
+            fprintf(fp, "precision,K,M,processes,time,bytes_per_point,l2,linf,l2_vs_double,linf_vs_double\n");
+        }
+        for (int r = 0; r < num_runs; r++) {
+            const RunStats *st = &stats[r];
+            PrecisionKind p = runs[r];
+            printf("Precision %s: %.4f seconds, %d bytes per point and step, halo %d bytes\n",
+                   precision_names[p], st->seconds, bytes_per_point[p],
+                   (p == PRECISION_DOUBLE) ? (int)sizeof(double) : (int)sizeof(float));
+            if (st->have_exact) {
+                printf("  Error at t=%g: L2=%.10e Linf=%.10e\n", K * g.tau, st->l2, st->linf);
+            } else {
+                printf("  Error at t=%g: no exact solution for this problem\n", K * g.tau);
+            }
+            if (r > 0) {
+                printf("  Difference to double: L2=%.10e Linf=%.10e, speedup %.2f\n",
+                       st->l2_ref, st->linf_ref, stats[0].seconds / st->seconds);
+            }
+            if (fp) {
+                fprintf(fp, "%s,%d,%d,%d,%.4f,%d,%.10e,%.10e,%.10e,%.10e\n", precision_names[p], K, M, size,
+                        st->seconds, bytes_per_point[p], st->have_exact ? st->l2 : NAN,
+                        st->have_exact ? st->linf : NAN, st->l2_ref, st->linf_ref);
+            }
+        }
+        if (fp) {
+            fclose(fp);
+            printf("Report appended to %s\n", REPORT_FILE);
+        }
+    }
+
+    free(reference);
+    free(result);
+    free(g.source);
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "transport_problem.h"
+#include "transport_schemes.h"
+#include "transport_stepper.h"
+#include "../trace/mpi_trace.h"
+
+// Parallel-in-time (Parareal) solver for the 1D transport equation
+//
+// [0, T] is split into one time slice per rank, every rank holds the whole
+// space grid. Two propagators advance a layer over one slice:
+//
+//   F  fine:   the cross scheme with the K-step tau, as in parr_test_full.c,
+//              restarted on every slice with its forward start-up step
+//   G  coarse: first-order upwind with the largest tau allowed by
+//              coarse_courant (default 0.9)
+//
+// Iteration 0 is a sequential coarse sweep. Iteration k computes F on all
+// slices at once and then corrects the slice boundaries in a pipeline:
+//
+//   U[n+1] = G(U_new[n]) + F(U_old[n]) - G(U_old[n])
+//
+// After k iterations the first k slices are exact, so at most 'size'
+// iterations reproduce the serial fine solution; usually far fewer are
+// needed. Iterations stop once no slice boundary moves by more than
+// parareal_tol (parareal_iters caps the count).
+//
+// Rank 0 first runs the serial fine solution on its own. It is the
+// baseline for the speedup and the reference the iterates are compared to.
+// The convergence history goes to parareal_convergence.csv: update size,
+// distance to the serial solution, elapsed time, measured speedup and the
+// model speedup N*Tf / ((k+1)*N*Tg + k*Tf) per iteration.
+//
+// Usage: mpirun -np 8 ./parareal [K M] [key=value ...]
+//        e.g. coarse_courant=0.5 parareal_tol=1e-8 T=4 X=4
+
+#define DEFAULT_K 20000
+#define DEFAULT_M 2000
+#define CONVERGENCE_FILE "parareal_convergence.csv"
+
+typedef struct {
+    const TransportConfig *cfg;
+    int M;
+    double h;
+    double tau;           // fine time step
+    double *source;       // steady source table, NULL otherwise
+    double *work[3];      // scratch layers of M + 1 points
+} Propagators;
+
+typedef struct {
+    double update;        // largest change of a slice boundary
+    double diff;          // distance of U(T) to the serial fine solution
+    double elapsed;
+} IterationStats;
+
+// Inflow at x=0 and zero-gradient outflow at x=X
+static void apply_boundaries(const TransportConfig *cfg, double *u, int M, double t) {
+    u[0] = problem_psi(cfg, t);
+    u[M] = u[M-1];
+}
+
+// Fine propagator: 'steps' cross steps from global step n0
+void fine_propagate(Propagators *p, const double *u0, double *out, int n0, int steps) {
+    const TransportConfig *cfg = p->cfg;
+    int M = p->M;
+    double tau = p->tau, h = p->h;
+    double courant = cfg->a * tau / h;
+    double *prev = p->work[0], *curr = p->work[1], *next = p->work[2];
+
+    memcpy(prev, u0, (M + 1) * sizeof(double));
+
+    // Forward start-up step, then the three-level cross scheme
+    central_step(cfg, curr, prev, prev, p->source, 1, M, 0, courant / 2, tau, n0 * tau, h);
+    apply_boundaries(cfg, curr, M, (n0 + 1) * tau);
+
+    for (int k = 1; k < steps; k++) {
+        central_step(cfg, next, prev, curr, p->source, 1, M, 0, courant, 2 * tau, (n0 + k) * tau, h);
+        apply_boundaries(cfg, next, M, (n0 + k + 1) * tau);
+
+        double *temp = prev;
+        prev = curr;
+        curr = next;
+        next = temp;
+    }
+
+    memcpy(out, curr, (M + 1) * sizeof(double));
+}
+
+// Coarse propagator: upwind over the same time interval with as few steps
+// as coarse_courant allows
+void coarse_propagate(Propagators *p, const double *u0, double *out, int n0, int steps) {
+    const TransportConfig *cfg = p->cfg;
+    int M = p->M;
+    double h = p->h;
+    double t0 = n0 * p->tau;
+    double span = steps * p->tau;
+
+    int coarse_steps = (int)ceil(fabs(cfg->a) * span / (cfg->coarse_courant * h));
+    if (coarse_steps < 1) {
+        coarse_steps = 1;
+    }
+    double tau_c = span / coarse_steps;
+    double courant = cfg->a * tau_c / h;
+
+    double *curr = out, *next = p->work[0];
+    memcpy(curr, u0, (M + 1) * sizeof(double));
+
+    for (int j = 0; j < coarse_steps; j++) {
+        upwind_step(cfg, next, curr, p->source, 1, M, 0, courant, tau_c, t0 + j * tau_c, h);
+        apply_boundaries(cfg, next, M, (j + 1 == coarse_steps) ? t0 + span : t0 + (j + 1) * tau_c);
+
+        double *temp = curr;
+        curr = next;
+        next = temp;
+    }
+
+    if (curr != out) {
+        memcpy(out, curr, (M + 1) * sizeof(double));
+    }
+}
+
+// Largest |a[i] - b[i]|, NaN wins
+static double max_difference(const double *a, const double *b, int n) {
+    double result = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = fabs(a[i] - b[i]);
+        if (!(d <= result)) {
+            result = d;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size;
+    TransportConfig cfg;
+    const char *positional[] = {"K", "M", NULL};
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Parse the problem on rank 0 and share it with everybody
+    if (rank == 0) {
+        problem_defaults(&cfg, DEFAULT_K, DEFAULT_M);
+        if (problem_parse_args(&cfg, argc, argv, positional) != 0) {
+            printf("Usage: %s [K M] [key=value ...] [config=file]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if ((cfg.cfl <= 0.0 && cfg.K < size) || cfg.coarse_courant <= 0.0) {
+            printf("Need K >= number of processes and coarse_courant > 0\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (cfg.scheme != SCHEME_CROSS || cfg.a_amp != 0.0) {
+            printf("Parareal needs the cross scheme with a constant velocity (scheme=cross, a_amp=0)\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        problem_print(&cfg);
+    }
+    MPI_Bcast(&cfg, sizeof(cfg), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    // With cfl > 0 the fine step is the largest stable one. The slices are
+    // cut from whole fine steps, so it is chosen once for all of [0, T]
+    // and is never longer than one step per slice
+    int M = cfg.M;
+    double h = cfg.x_max / M;
+    int K = stepper_step_count(&cfg, h);
+    if (K < size) {
+        K = size;
+    }
+    cfg.K = K;
+    int max_iters = (cfg.parareal_iters > 0) ? cfg.parareal_iters : size;
+    double tau = cfg.t_max / K;
+
+    if (rank == 0) {
+        if (cfg.cfl <= 0.0 && fabs(cfg.a * tau / h) > scheme_info[SCHEME_CROSS].cfl_limit) {
+            printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", fabs(cfg.a * tau / h));
+        }
+        if (cfg.cfl > 0.0) {
+            if (cfg.cfl > scheme_info[SCHEME_CROSS].cfl_limit) {
+                printf("Warning: cfl=%g is above the stability limit %g of scheme cross\n",
+                       cfg.cfl, scheme_info[SCHEME_CROSS].cfl_limit);
+            }
+            printf("Adaptive step: %d fine steps, tau %.4e (cfl %g)\n", K, tau, cfg.cfl);
+        }
+    }
+
+    // Time slice of every rank: fine steps first_step .. first_step+steps-1
+    int first_step = rank * (K / size) + ((rank < K % size) ? rank : K % size);
+    int steps = K / size + ((rank < K % size) ? 1 : 0);
+
+    Propagators prop;
+    prop.cfg = &cfg;
+    prop.M = M;
+    prop.h = h;
+    prop.tau = tau;
+    prop.source = NULL;
+    if (problem_source_is_steady(&cfg)) {
+        prop.source = (double *)malloc((M + 1) * sizeof(double));
+        problem_tabulate_source(&cfg, 0, M + 1, h, prop.source);
+    }
+
+    int n = M + 1;
+    for (int i = 0; i < 3; i++) {
+        prop.work[i] = (double *)calloc(n, sizeof(double));
+    }
+    double *u_start = (double *)malloc(n * sizeof(double));   // U[rank]
+    double *u_fine = (double *)malloc(n * sizeof(double));    // F(U[rank])
+    double *u_coarse = (double *)malloc(n * sizeof(double));  // G(U[rank])
+    double *u_end = (double *)malloc(n * sizeof(double));     // U[rank+1]
+    double *u_new = (double *)malloc(n * sizeof(double));
+    double *received = (double *)malloc(n * sizeof(double));
+    double *reference = NULL;
+
+    // Initial layer, it never changes on rank 0
+    problem_tabulate_phi(&cfg, 0, n, h, u_start);
+    u_start[0] = problem_psi(&cfg, 0.0);
+
+    // Serial fine baseline: the same slice by slice restarts, so converged
+    // iterates agree with it to rounding
+    double serial_time = 0.0;
+    if (rank == 0) {
+        reference = (double *)malloc(n * sizeof(double));
+        memcpy(reference, u_start, n * sizeof(double));
+
+        double t0 = MPI_Wtime();
+        for (int r = 0; r < size; r++) {
+            int r_first = r * (K / size) + ((r < K % size) ? r : K % size);
+            int r_steps = K / size + ((r < K % size) ? 1 : 0);
+            fine_propagate(&prop, reference, reference, r_first, r_steps);
+        }
+        serial_time = MPI_Wtime() - t0;
+
+        if (size > 1) {
+            MPI_Send(reference, n, MPI_DOUBLE, size - 1, 1, MPI_COMM_WORLD);
+        }
+    } else if (rank == size - 1) {
+        reference = (double *)malloc(n * sizeof(double));
+        MPI_Recv(reference, n, MPI_DOUBLE, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+
+    IterationStats *history = (IterationStats *)calloc(max_iters + 1, sizeof(IterationStats));
+    double fine_time = 0.0, coarse_time = 0.0;
+    int fine_calls = 0, coarse_calls = 0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_time = MPI_Wtime();
+
+    // Iteration 0: sequential coarse sweep
+    if (rank > 0) {
+        MPI_Recv(u_start, n, MPI_DOUBLE, rank - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+    trace_begin("coarse");
+    double t0 = MPI_Wtime();
+    coarse_propagate(&prop, u_start, u_coarse, first_step, steps);
+    coarse_time += MPI_Wtime() - t0;
+    coarse_calls++;
+    trace_end();
+    memcpy(u_end, u_coarse, n * sizeof(double));
+    if (rank < size - 1) {
+        MPI_Send(u_end, n, MPI_DOUBLE, rank + 1, 0, MPI_COMM_WORLD);
+    }
+
+    int iterations = 0;
+    int fine_valid = 0;   // u_fine belongs to the current u_start
+    for (int k = 0; ; k++) {
+        // Convergence bookkeeping of the iterate just finished
+        double local[2] = {0.0, 0.0}, global[2];
+        if (k > 0) {
+            local[0] = history[k].update;
+        }
+        if (rank == size - 1) {
+            local[1] = max_difference(u_end, reference, n);
+        }
+        MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        history[k].update = global[0];
+        history[k].diff = global[1];
+        history[k].elapsed = MPI_Wtime() - start_time;
+        iterations = k;
+
+        if ((k > 0 && !(global[0] > cfg.parareal_tol)) || k == max_iters) {
+            break;
+        }
+
+        // Fine propagation of every slice at once; slices whose start did
+        // not change since the last iteration keep their result
+        if (!fine_valid) {
+            trace_begin("fine");
+            t0 = MPI_Wtime();
+            fine_propagate(&prop, u_start, u_fine, first_step, steps);
+            fine_time += MPI_Wtime() - t0;
+            fine_calls++;
+            fine_valid = 1;
+            trace_end();
+        }
+
+        // Pipelined correction: new start from the left neighbour, new
+        // coarse result, corrected end for the right neighbour
+        int changed = 0;
+        if (rank > 0) {
+            trace_begin("correction");
+            MPI_Recv(received, n, MPI_DOUBLE, rank - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            trace_end();
+            changed = memcmp(received, u_start, n * sizeof(double)) != 0;
+        }
+
+        trace_begin("coarse");
+        if (changed) {
+            t0 = MPI_Wtime();
+            coarse_propagate(&prop, received, u_new, first_step, steps);
+            coarse_time += MPI_Wtime() - t0;
+            coarse_calls++;
+        } else {
+            memcpy(u_new, u_coarse, n * sizeof(double));
+        }
+        trace_end();
+
+        double update = 0.0;
+        for (int i = 0; i < n; i++) {
+            double value = u_fine[i] + (u_new[i] - u_coarse[i]);
+            double d = fabs(value - u_end[i]);
+            if (!(d <= update)) {
+                update = d;
+            }
+            u_end[i] = value;
+        }
+        history[k + 1].update = update;
+
+        if (rank < size - 1) {
+            trace_begin("correction");
+            MPI_Send(u_end, n, MPI_DOUBLE, rank + 1, 0, MPI_COMM_WORLD);
+            trace_end();
+        }
+
+        double *temp;
+        if (changed) {
+            temp = u_start;
+            u_start = received;
+            received = temp;
+            fine_valid = 0;
+        }
+        temp = u_coarse;
+        u_coarse = u_new;
+        u_new = temp;
+    }
+
+    double total_time = MPI_Wtime() - start_time;
+
+    // Error of U(T) on the last slice against the exact solution
+    double err_local[2] = {0.0, 0.0};
+    int have_exact = 1;
+    if (rank == size - 1) {
+        have_exact = problem_error(&cfg, cfg.t_max, 0, n, h, u_end, &err_local[0], &err_local[1]);
+    }
+    double err[2];
+    MPI_Reduce(err_local, err, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&have_exact, 1, MPI_INT, size - 1, MPI_COMM_WORLD);
+
+    // Mean propagator cost per slice for the speedup model
+    double costs_local[2] = {fine_calls ? fine_time / fine_calls : 0.0,
+                             coarse_calls ? coarse_time / coarse_calls : 0.0};
+    double costs[2];
+    MPI_Reduce(costs_local, costs, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double tf = costs[0] / size, tg = costs[1] / size;
+        FILE *fp = fopen(CONVERGENCE_FILE, "w");
+        if (fp) {
+            fprintf(fp, "iteration,update,diff_serial,time,speedup,model_speedup\n");
+        }
+
+        printf("Parareal: %d slices, %d fine steps, fine %.3e s / coarse %.3e s per slice\n",
+               size, K, tf, tg);
+        printf("%5s %12s %12s %10s %8s %8s\n", "iter", "update", "vs serial", "time, s", "S", "S_model");
+        for (int k = 0; k <= iterations; k++) {
+            double speedup = serial_time / history[k].elapsed;
+            double model = size * tf / ((k + 1) * size * tg + k * tf);
+            printf("%5d %12.4e %12.4e %10.4f %8.2f %8.2f\n", k, history[k].update, history[k].diff,
+                   history[k].elapsed, speedup, model);
+            if (fp) {
+                fprintf(fp, "%d,%.6e,%.6e,%.6f,%.4f,%.4f\n", k, history[k].update, history[k].diff,
+                        history[k].elapsed, speedup, model);
+            }
+        }
+        if (fp) {
+            fclose(fp);
+            printf("Convergence history saved to %s\n", CONVERGENCE_FILE);
+        }
+
+        if (have_exact) {
+            printf("Error at t=%g: L2=%.10e Linf=%.10e\n", cfg.t_max, sqrt(h * err[0]), err[1]);
+        } else {
+            printf("Error at t=%g: no exact solution for this problem\n", cfg.t_max);
+        }
+        printf("Serial fine time: %.4f seconds\n", serial_time);
+        printf("Total execution time: %.4f seconds (parareal, %d iterations, speedup %.2f)\n",
+               total_time, iterations, serial_time / total_time);
+
+        // Вывод в формате: K,M,processes,time
+        printf("%d,%d,%d,%.4f\n", K, M, size, total_time);
+    }
+
+    // Cleanup
+    for (int i = 0; i < 3; i++) {
+        free(prop.work[i]);
+    }
+    free(prop.source);
+    free(u_start);
+    free(u_fine);
+    free(u_coarse);
+    free(u_end);
+    free(u_new);
+    free(received);
+    free(reference);
+    free(history);
+
+    MPI_Finalize();
+    return 0;
+}
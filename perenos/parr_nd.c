@@ -0,0 +1,447 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "transport_problem.h"
+#include "transport_stepper.h"
+#include "../trace/mpi_trace.h"
+
+// Multi-dimensional transport equation
+//
+//     u_t + a u_x + a_y u_y + a_z u_z = f(t,x),   (x,y,z) in [0,X]^dim
+//     u(0,x,y,z) = phi(x) phi(y) phi(z),   u = psi(t) on the inflow faces
+//
+// solved with the cross scheme on a Cartesian process grid (MPI_Cart_create).
+// phi, psi and f come from the same runtime problem layer as parr_test_full.c
+// (transport_problem.h); dim=2 or dim=3 selects the dimension, M is the number
+// of steps per direction. Velocities are assumed non-negative: the faces at 0
+// are inflow (psi), the faces at X are zero-gradient outflow.
+//
+// Face halos are exchanged with subarray datatypes straight from the solution
+// arrays, and the update is tiled over the two fastest directions so that the
+// three planes a stencil touches stay in cache.
+
+#define DEFAULT_K 1000
+#define DEFAULT_M 1000
+#define MAX_DIM 3
+
+// Local block: owned points plus one ghost layer in every decomposed
+// direction. Unused directions (z in 2D) have one point and no ghosts.
+typedef struct {
+    int dim;
+    int n[MAX_DIM];            // owned points per direction
+    int start[MAX_DIM];        // global index of the first owned point
+    int g[MAX_DIM];            // ghost width per direction
+    int ext[MAX_DIM];          // allocated extent n + 2g
+    long size;                 // allocated points
+    int neighbor[MAX_DIM][2];  // low / high neighbours (MPI_PROC_NULL on the border)
+    MPI_Datatype send_face[MAX_DIM][2];
+    MPI_Datatype recv_face[MAX_DIM][2];
+} Block;
+
+static inline long idx(const Block *b, int i, int j, int k) {
+    return ((long)i * b->ext[1] + j) * b->ext[2] + k;
+}
+
+// Block distribution of 'points' over 'parts', remainder to the first parts
+void split_points(int points, int parts, int coord, int *count, int *start) {
+    int base = points / parts;
+    int rem = points % parts;
+    *count = base + ((coord < rem) ? 1 : 0);
+    *start = coord * base + ((coord < rem) ? coord : rem);
+}
+
+// Face of the owned region (ghost = 0) or of the ghost layer (ghost = 1)
+MPI_Datatype make_face(const Block *b, int d, int side, int ghost) {
+    int sizes[MAX_DIM], subsizes[MAX_DIM], starts[MAX_DIM];
+    MPI_Datatype face;
+
+    for (int e = 0; e < MAX_DIM; e++) {
+        sizes[e] = b->ext[e];
+        subsizes[e] = b->n[e];
+        starts[e] = b->g[e];
+    }
+    subsizes[d] = 1;
+    if (side == 0) {
+        starts[d] = ghost ? 0 : b->g[d];
+    } else {
+        starts[d] = ghost ? b->g[d] + b->n[d] : b->g[d] + b->n[d] - 1;
+    }
+
+    MPI_Type_create_subarray(MAX_DIM, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &face);
+    MPI_Type_commit(&face);
+    return face;
+}
+
+// Exchange all faces of one layer with the Cartesian neighbours
+void exchange_faces(double *u, const Block *b, MPI_Comm cart) {
+    for (int d = 0; d < b->dim; d++) {
+        // Upwards: high face to the upper neighbour, low ghosts from the lower one
+        MPI_Sendrecv(u, 1, b->send_face[d][1], b->neighbor[d][1], d,
+                     u, 1, b->recv_face[d][0], b->neighbor[d][0], d,
+                     cart, MPI_STATUS_IGNORE);
+        // Downwards
+        MPI_Sendrecv(u, 1, b->send_face[d][0], b->neighbor[d][0], MAX_DIM + d,
+                     u, 1, b->recv_face[d][1], b->neighbor[d][1], MAX_DIM + d,
+                     cart, MPI_STATUS_IGNORE);
+    }
+}
+
+// Cross-scheme update of the local points lo .. hi-1 (per direction):
+//     u_next = u_base - sum_d c[d] * (u_diff[+e_d] - u_diff[-e_d]) + s * f
+// 'fx' holds s * f(t, x_i) per local i, or is NULL for a zero source.
+// The loops are tiled over j (and k in 3D) with edge 'block'.
+void cross_sweep(double *u_next, const double *u_base, const double *u_diff, const Block *b,
+                 const int lo[MAX_DIM], const int hi[MAX_DIM], const double c[MAX_DIM],
+                 const double *fx, int block) {
+    long sx = (long)b->ext[1] * b->ext[2];
+    long sy = b->ext[2];
+
+    if (b->dim == 2) {
+        for (int jj = lo[1]; jj < hi[1]; jj += block) {
+            int jend = (jj + block < hi[1]) ? jj + block : hi[1];
+            for (int i = lo[0]; i < hi[0]; i++) {
+                double fi = fx ? fx[i] : 0.0;
+                for (int j = jj; j < jend; j++) {
+                    long p = idx(b, i, j, 0);
+                    u_next[p] = u_base[p] - c[0] * (u_diff[p + sx] - u_diff[p - sx])
+                                          - c[1] * (u_diff[p + sy] - u_diff[p - sy]) + fi;
+                }
+            }
+        }
+        return;
+    }
+
+    for (int jj = lo[1]; jj < hi[1]; jj += block) {
+        int jend = (jj + block < hi[1]) ? jj + block : hi[1];
+        for (int kk = lo[2]; kk < hi[2]; kk += block) {
+            int kend = (kk + block < hi[2]) ? kk + block : hi[2];
+            for (int i = lo[0]; i < hi[0]; i++) {
+                double fi = fx ? fx[i] : 0.0;
+                for (int j = jj; j < jend; j++) {
+                    for (int k = kk; k < kend; k++) {
+                        long p = idx(b, i, j, k);
+                        u_next[p] = u_base[p] - c[0] * (u_diff[p + sx] - u_diff[p - sx])
+                                              - c[1] * (u_diff[p + sy] - u_diff[p - sy])
+                                              - c[2] * (u_diff[p + 1] - u_diff[p - 1]) + fi;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Outflow faces (global index M) copy their inner neighbour, then inflow
+// faces (global index 0) take psi; corners shared by both end up inflow
+void apply_boundaries(double *u, const Block *b, int M, double psi_value) {
+    for (int d = 0; d < b->dim; d++) {
+        int lo[MAX_DIM], hi[MAX_DIM];
+        long stride = (d == 0) ? (long)b->ext[1] * b->ext[2] : (d == 1) ? b->ext[2] : 1;
+
+        for (int e = 0; e < MAX_DIM; e++) {
+            lo[e] = b->g[e];
+            hi[e] = b->g[e] + b->n[e];
+        }
+        if (b->start[d] + b->n[d] - 1 != M) {
+            continue;
+        }
+        lo[d] = b->g[d] + b->n[d] - 1;
+        hi[d] = lo[d] + 1;
+        for (int i = lo[0]; i < hi[0]; i++) {
+            for (int j = lo[1]; j < hi[1]; j++) {
+                for (int k = lo[2]; k < hi[2]; k++) {
+                    long p = idx(b, i, j, k);
+                    u[p] = u[p - stride];
+                }
+            }
+        }
+    }
+
+    for (int d = 0; d < b->dim; d++) {
+        int lo[MAX_DIM], hi[MAX_DIM];
+
+        if (b->start[d] != 0) {
+            continue;
+        }
+        for (int e = 0; e < MAX_DIM; e++) {
+            lo[e] = b->g[e];
+            hi[e] = b->g[e] + b->n[e];
+        }
+        hi[d] = lo[d] + 1;
+        for (int i = lo[0]; i < hi[0]; i++) {
+            for (int j = lo[1]; j < hi[1]; j++) {
+                for (int k = lo[2]; k < hi[2]; k++) {
+                    u[idx(b, i, j, k)] = psi_value;
+                }
+            }
+        }
+    }
+}
+
+// Source contribution s * f(t, x_i) per local i, NULL for a zero source
+double *source_row(const TransportConfig *cfg, const Block *b, double *fx, double s, double t, double h) {
+    if (cfg->f == SOURCE_ZERO) {
+        return NULL;
+    }
+    for (int i = 0; i < b->ext[0]; i++) {
+        fx[i] = s * problem_f(cfg, t, (b->start[0] + i - b->g[0]) * h);
+    }
+    return fx;
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size;
+    TransportConfig cfg;
+    const char *positional[] = {"K", "M", "dim", NULL};
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Parse the problem on rank 0 and share it with everybody
+    if (rank == 0) {
+        problem_defaults(&cfg, DEFAULT_K, DEFAULT_M);
+        if (problem_parse_args(&cfg, argc, argv, positional) != 0 || cfg.dim < 2 || cfg.dim > 3) {
+            printf("Usage: %s [K M [dim]] [key=value ...] [config=file]   (dim = 2 or 3)\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (cfg.scheme != SCHEME_CROSS || cfg.a_amp != 0.0) {
+            printf("The multi-dimensional solver needs the cross scheme with a constant velocity "
+                   "(scheme=cross, a_amp=0)\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        problem_print(&cfg);
+    }
+    MPI_Bcast(&cfg, sizeof(cfg), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    int K = cfg.K, M = cfg.M, dim = cfg.dim;
+    int adaptive = cfg.cfl > 0.0;
+    int block_edge = (cfg.block > 0) ? cfg.block : 1;
+    double tau = cfg.t_max / K;
+    double h = cfg.x_max / M;
+    double velocity[MAX_DIM] = {cfg.a, cfg.a_y, (dim == 3) ? cfg.a_z : 0.0};
+
+    // Cartesian process grid
+    int dims[MAX_DIM] = {0, 0, 0};
+    int periods[MAX_DIM] = {0, 0, 0};
+    int coords[MAX_DIM] = {0, 0, 0};
+    MPI_Comm cart;
+
+    MPI_Dims_create(size, dim, dims);
+    if (dim == 2) {
+        dims[2] = 1;
+    }
+    MPI_Cart_create(MPI_COMM_WORLD, dim, dims, periods, 1, &cart);
+    MPI_Comm_rank(cart, &rank);
+    MPI_Cart_coords(cart, rank, dim, coords);
+
+    Block b;
+    b.dim = dim;
+    b.size = 1;
+    for (int d = 0; d < MAX_DIM; d++) {
+        if (d < dim) {
+            split_points(M + 1, dims[d], coords[d], &b.n[d], &b.start[d]);
+            b.g[d] = 1;
+            MPI_Cart_shift(cart, d, 1, &b.neighbor[d][0], &b.neighbor[d][1]);
+        } else {
+            b.n[d] = 1;
+            b.start[d] = 0;
+            b.g[d] = 0;
+            b.neighbor[d][0] = b.neighbor[d][1] = MPI_PROC_NULL;
+        }
+        b.ext[d] = b.n[d] + 2 * b.g[d];
+        b.size *= b.ext[d];
+    }
+
+    // The outflow copy needs the inner neighbour of x=X on the same rank
+    int too_thin = 0, any_too_thin;
+    for (int d = 0; d < dim; d++) {
+        if (b.n[d] < 2) {
+            too_thin = 1;
+        }
+    }
+    MPI_Allreduce(&too_thin, &any_too_thin, 1, MPI_INT, MPI_LOR, cart);
+    if (any_too_thin) {
+        if (rank == 0) {
+            printf("Error: every process needs at least 2 points per direction, increase M\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (int d = 0; d < dim; d++) {
+        for (int side = 0; side < 2; side++) {
+            b.send_face[d][side] = make_face(&b, d, side, 0);
+            b.recv_face[d][side] = make_face(&b, d, side, 1);
+        }
+    }
+
+    // Check stability condition for the cross scheme: sum |a_d|*tau/h <= 1
+    double speed = 0.0;
+    for (int d = 0; d < dim; d++) {
+        speed += fabs(velocity[d]);
+    }
+    double courant = speed * tau / h;
+    if (rank == 0) {
+        printf("Process grid: %d x %d x %d, local block %d x %d x %d\n",
+               dims[0], dims[1], dims[2], b.n[0], b.n[1], b.n[2]);
+        if (!adaptive && courant > 1.0) {
+            printf("Warning: Stability condition not satisfied (sum |a_d|*tau/h = %f)\n", courant);
+            printf("Solution may be unstable. Consider reducing tau or increasing h.\n");
+        }
+        if (adaptive && cfg.cfl > 1.0) {
+            printf("Warning: cfl=%g is above the stability limit 1 of scheme cross\n", cfg.cfl);
+        }
+    }
+
+    // With cfl > 0 the step is cfl * h / sum |a_d|, the velocity is
+    // constant, so it is chosen once and only the first step is a start-up
+    TimeStepper step;
+    stepper_init(&step, &cfg, h, 1, adaptive, NULL);
+    step.speed = speed;
+
+    // Three time layers
+    double *u_prev = (double *)calloc(b.size, sizeof(double));
+    double *u_curr = (double *)calloc(b.size, sizeof(double));
+    double *u_next = (double *)calloc(b.size, sizeof(double));
+    double *fx = (double *)malloc(b.ext[0] * sizeof(double));
+
+    // Initial condition: product of the 1D profiles, tabulated per direction
+    double *profile[MAX_DIM];
+    for (int d = 0; d < MAX_DIM; d++) {
+        profile[d] = (double *)malloc(b.n[d] * sizeof(double));
+        if (d < dim) {
+            problem_tabulate_phi(&cfg, b.start[d], b.n[d], h, profile[d]);
+        } else {
+            profile[d][0] = 1.0;
+        }
+    }
+    for (int i = 0; i < b.n[0]; i++) {
+        for (int j = 0; j < b.n[1]; j++) {
+            for (int k = 0; k < b.n[2]; k++) {
+                u_curr[idx(&b, i + b.g[0], j + b.g[1], k + b.g[2])] =
+                    profile[0][i] * profile[1][j] * profile[2][k];
+            }
+        }
+    }
+    double *psi_table = adaptive ? NULL : problem_tabulate_psi(&cfg, tau);
+    apply_boundaries(u_curr, &b, M, problem_psi(&cfg, 0.0));
+
+    // Points updated by the scheme: owned, global index in 1 .. M-1
+    int lo[MAX_DIM], hi[MAX_DIM];
+    for (int d = 0; d < MAX_DIM; d++) {
+        if (d < dim) {
+            int first = (b.start[d] > 1) ? b.start[d] : 1;
+            int last = (b.start[d] + b.n[d] - 1 < M - 1) ? b.start[d] + b.n[d] - 1 : M - 1;
+            lo[d] = first - b.start[d] + b.g[d];
+            hi[d] = last - b.start[d] + b.g[d] + 1;
+        } else {
+            lo[d] = 0;
+            hi[d] = 1;
+        }
+    }
+
+    double c[MAX_DIM], c_half[MAX_DIM];
+
+    MPI_Barrier(cart);
+    double start_time = MPI_Wtime();
+
+    // Cross scheme, the first step with forward time, central space
+    for (; !stepper_done(&step); stepper_advance(&step)) {
+        int k = step.k;
+        stepper_next(&step, &cfg);
+        double t = step.t;
+        tau = step.tau;
+        double psi_next = psi_table ? psi_table[k+1] : problem_psi(&cfg, t + tau);
+
+        trace_begin("halo");
+        exchange_faces(u_curr, &b, cart);
+        trace_end();
+
+        trace_begin("compute");
+        if (step.restart) {
+            for (int d = 0; d < MAX_DIM; d++) {
+                c[d] = velocity[d] * tau / h;
+                c_half[d] = c[d] / 2;
+            }
+            cross_sweep(u_next, u_curr, u_curr, &b, lo, hi, c_half,
+                        source_row(&cfg, &b, fx, tau, t, h), block_edge);
+        } else {
+            cross_sweep(u_next, u_prev, u_curr, &b, lo, hi, c,
+                        source_row(&cfg, &b, fx, 2 * tau, t, h), block_edge);
+        }
+        apply_boundaries(u_next, &b, M, psi_next);
+        trace_end();
+
+        // Rotate time layers (prev <- curr <- next)
+        double *temp = u_prev;
+        u_prev = u_curr;
+        u_curr = u_next;
+        u_next = temp;
+    }
+
+    double local_elapsed = MPI_Wtime() - start_time;
+    double exec_time;
+    MPI_Reduce(&local_elapsed, &exec_time, 1, MPI_DOUBLE, MPI_MAX, 0, cart);
+
+    K = step.k;
+    if (rank == 0 && adaptive) {
+        printf("Adaptive step: %d steps, tau %.4e (cfl %g)\n", K, step.tau, cfg.cfl);
+    }
+
+    // Check against the travelling wave phi(x - a t) phi(y - a_y t) ...,
+    // which is the exact solution for f = 0 away from the inflow faces
+    double t_end = step.t;
+    double local_norm = 0.0, local_dev = 0.0, norm, deviation;
+    for (int i = 0; i < b.n[0]; i++) {
+        double px = problem_phi(&cfg, (b.start[0] + i) * h - velocity[0] * t_end);
+        for (int j = 0; j < b.n[1]; j++) {
+            double py = problem_phi(&cfg, (b.start[1] + j) * h - velocity[1] * t_end);
+            for (int k = 0; k < b.n[2]; k++) {
+                double pz = (dim == 3) ? problem_phi(&cfg, (b.start[2] + k) * h - velocity[2] * t_end) : 1.0;
+                double value = u_curr[idx(&b, i + b.g[0], j + b.g[1], k + b.g[2])];
+                local_norm += value * value;
+                if (fabs(value - px * py * pz) > local_dev) {
+                    local_dev = fabs(value - px * py * pz);
+                }
+            }
+        }
+    }
+    MPI_Reduce(&local_norm, &norm, 1, MPI_DOUBLE, MPI_SUM, 0, cart);
+    MPI_Reduce(&local_dev, &deviation, 1, MPI_DOUBLE, MPI_MAX, 0, cart);
+
+    if (rank == 0) {
+        printf("Solution L2 norm at t=%g: %.10e\n", t_end, sqrt(norm * pow(h, dim)));
+        printf("Max deviation from the travelling wave: %.6e\n", deviation);
+        printf("Total execution time: %.4f seconds\n", exec_time);
+
+        // Вывод в формате: dim,K,M,processes,time
+        printf("%d,%d,%d,%d,%.4f\n", dim, K, M, size, exec_time);
+
+        // Запись в файл
+        FILE *f = fopen("benchmark_results_nd.csv", "a");
+        if (f) {
+            fprintf(f, "%d,%d,%d,%d,%.4f\n", dim, K, M, size, exec_time);
+            fclose(f);
+        }
+    }
+
+    // Cleanup
+    for (int d = 0; d < dim; d++) {
+        for (int side = 0; side < 2; side++) {
+            MPI_Type_free(&b.send_face[d][side]);
+            MPI_Type_free(&b.recv_face[d][side]);
+        }
+    }
+    for (int d = 0; d < MAX_DIM; d++) {
+        free(profile[d]);
+    }
+    free(u_prev);
+    free(u_curr);
+    free(u_next);
+    free(fx);
+    free(psi_table);
+    MPI_Comm_free(&cart);
+
+    MPI_Finalize();
+    return 0;
+}
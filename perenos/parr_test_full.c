@@ -1,65 +1,375 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
 #include <mpi.h>
+#include "transport_problem.h"
+#include "transport_schemes.h"
+#include "transport_stepper.h"
+#include "../trace/mpi_trace.h"
 
-// Parameters for the transport equation
-#define A 1.0         // coefficient 'a' in the equation
-#define T 1.0         // max time
-#define X 1.0         // max x coordinate
-#define NUM_SNAPSHOTS 9  // Number of time snapshots to save
+// The problem (a, T, X, phi, psi, f) is configured at runtime, see
+// transport_problem.h; defaults reproduce the gaussian pulse with a = 1
 #define NUM_SNAP_SAVE 3
 
+// Asynchronous snapshot output
+#define SNAPSHOT_SLOTS 2      // staging buffers that may be in flight at once
+#define SNAPSHOT_SPOOL "transport_snapshots.bin"
+#define CSV_CHUNK_ROWS 4096   // rows converted per read from the spool
+
+// Binary output (convert with bin_to_csv.py)
+#define BINARY_OUTPUT "transport_solution_mpi.bin"
+#define BINARY_MAGIC "TRSNAP01"
+#define BINARY_VERSION 1
+
 #define DEFAULT_K 100000
 #define DEFAULT_M 100000
 
-// Initial and boundary conditions
-double phi(double x) {
-    // Example: initial condition u(0,x) = gaussian pulse
-    return exp(-(x - X / 2) * (x - X / 2) * 100);
+// Binary snapshot file layout:
+//   BinaryHeader | double times[capacity] | double u[capacity][npoints]
+// Every rank writes its own points of a snapshot with MPI_File_write_at_all,
+// so no rank has to hold or format the whole solution.
+typedef struct {
+    char magic[8];          // BINARY_MAGIC, not zero-terminated
+    int32_t version;
+    int32_t header_bytes;   // sizeof(BinaryHeader), offset of the time table
+    int64_t npoints;        // M + 1
+    int64_t nsnapshots;     // snapshots actually written
+    int64_t capacity;       // snapshot slots reserved in the file
+    double h;               // x_i = i * h
+    double tau;
+    double a;
+} BinaryHeader;
+
+// Zero-gradient outflow at x=X, on the process that owns it
+void outflow_boundary(double *u_next, int interior_end, int local_start, int local_count, int M) {
+    if (local_start + local_count - 1 == M) {
+        u_next[interior_end] = u_next[interior_end - 1];
+    }
 }
 
-double psi(double t) {
-    // Example: boundary condition u(t,0) = 0
-    return 0.0;
+// One step of a two-level scheme from u to u_next. Explicit schemes update
+// first .. interior_end-1 and copy the outflow point; Crank-Nicolson solves
+// for all owned points at once.
+void scheme_step(const TransportConfig *cfg, CrankNicolson *cn, double *u_next, const double *u,
+                 const double *source, int first, int interior_end, int global_offset,
+                 int ghost_left, int local_start, int local_count, int M, double psi_next,
+                 double courant, double tau, double t, double h) {
+    switch (cfg->scheme) {
+        case SCHEME_UPWIND:
+            upwind_step(cfg, u_next, u, source, first, interior_end, global_offset, courant, tau, t, h);
+            break;
+        case SCHEME_LAX_WENDROFF:
+            lax_wendroff_step(cfg, u_next, u, source, first, interior_end, global_offset, courant, tau, t, h);
+            break;
+        case SCHEME_CRANK_NICOLSON:
+            cn_step(cn, cfg, u_next, u, source, ghost_left, local_start, local_count, M, psi_next, tau, t, h);
+            return;
+        default:
+            return;
+    }
+    
+    outflow_boundary(u_next, interior_end, local_start, local_count, M);
 }
 
-double f(double t, double x) {
-    // Example: source term f(t,x) = 0
-    return 0.0;
+// Ghost-cell exchange with both neighbours. The pattern never changes, so
+// the requests are created once with MPI_Send_init / MPI_Recv_init on
+// fixed one-value buffers and only restarted every step.
+//
+// With halo=shared the three time layers of every rank live in an MPI-3
+// shared window of its node, and a neighbour on the same node is read
+// directly instead of being sent a message. Each rank publishes the number
+// of the last layer it finished in a counter at the head of its segment;
+// the reader spins on the neighbour's counter. All ranks rotate the layers
+// in step, so layer k sits in the same slot everywhere, and a slot is only
+// overwritten two steps after the neighbour has read it. Only neighbours on
+// another node still go through persistent requests.
+#define HALO_LAYERS 3
+#define HALO_HEADER 64        // bytes before the layers, one cache line for the counter
+
+typedef struct {
+    double send[2];           // [0] to the left neighbour, [1] to the right one
+    double recv[2];
+    MPI_Request requests[4];
+    int count;
+    
+    // Shared-memory mode
+    int shared[2];            // neighbour is on this node and read directly
+    MPI_Comm node;
+    MPI_Win win;
+    double *layers;           // HALO_LAYERS * local_size values of this rank
+    atomic_long *ready;       // last layer this rank has finished
+    const double *peer[2];    // neighbours' layers
+    atomic_long *peer_ready[2];
+    int peer_size[2];         // neighbours' local_size
+    int local_size;
+} Halo;
+
+// Map 'neighbour' (a rank of MPI_COMM_WORLD) to its segment in the node window
+static void halo_attach_peer(Halo *halo, int side, int neighbour) {
+    MPI_Group world_group, node_group;
+    int node_rank;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(halo->node, &node_group);
+    MPI_Group_translate_ranks(world_group, 1, &neighbour, node_group, &node_rank);
+    MPI_Group_free(&world_group);
+    MPI_Group_free(&node_group);
+    
+    if (node_rank == MPI_UNDEFINED) {
+        return;
+    }
+    
+    MPI_Aint bytes;
+    int disp_unit;
+    char *base;
+    MPI_Win_shared_query(halo->win, node_rank, &bytes, &disp_unit, &base);
+    
+    halo->shared[side] = 1;
+    halo->peer_ready[side] = (atomic_long *)base;
+    halo->peer[side] = (const double *)(base + HALO_HEADER);
+    halo->peer_size[side] = (int)((bytes - HALO_HEADER) / (HALO_LAYERS * sizeof(double)));
 }
 
-int main(int argc, char *argv[]) {
-    int rank, size;
-    double start_time, end_time;
-    int K = DEFAULT_K, M = DEFAULT_M;
-    double tau = T / K;       // time step
-    double h = X / M;         // space step
+// Set up the exchange and return storage for the HALO_LAYERS time layers
+double *halo_setup(Halo *halo, int local_size, int rank, int size, int shared) {
+    memset(halo, 0, sizeof(*halo));
+    halo->local_size = local_size;
+    halo->win = MPI_WIN_NULL;
+    halo->node = MPI_COMM_NULL;
+    
+    if (shared) {
+        char *base;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &halo->node);
+        MPI_Win_allocate_shared(HALO_HEADER + (MPI_Aint)HALO_LAYERS * local_size * sizeof(double), 1,
+                                MPI_INFO_NULL, halo->node, &base, &halo->win);
+        halo->ready = (atomic_long *)base;
+        halo->layers = (double *)(base + HALO_HEADER);
+        
+        // Passive epoch for the whole run, MPI_Win_sync orders the plain
+        // loads and stores of the layers around the counters
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, halo->win);
+        atomic_store(halo->ready, -1);
+        MPI_Win_sync(halo->win);
+        MPI_Barrier(halo->node);
+        
+        if (rank > 0) {
+            halo_attach_peer(halo, 0, rank - 1);
+        }
+        if (rank < size - 1) {
+            halo_attach_peer(halo, 1, rank + 1);
+        }
+    } else {
+        halo->layers = (double *)malloc(HALO_LAYERS * local_size * sizeof(double));
+    }
+    
+    if (rank > 0 && !halo->shared[0]) {
+        MPI_Send_init(&halo->send[0], 1, MPI_DOUBLE, rank-1, 0, MPI_COMM_WORLD, &halo->requests[halo->count++]);
+        MPI_Recv_init(&halo->recv[0], 1, MPI_DOUBLE, rank-1, 0, MPI_COMM_WORLD, &halo->requests[halo->count++]);
+    }
+    if (rank < size - 1 && !halo->shared[1]) {
+        MPI_Send_init(&halo->send[1], 1, MPI_DOUBLE, rank+1, 0, MPI_COMM_WORLD, &halo->requests[halo->count++]);
+        MPI_Recv_init(&halo->recv[1], 1, MPI_DOUBLE, rank+1, 0, MPI_COMM_WORLD, &halo->requests[halo->count++]);
+    }
+    
+    return halo->layers;
+}
+
+// Mark time layer 'layer' of this rank as complete (shared mode only)
+void halo_publish(Halo *halo, long layer) {
+    if (halo->win != MPI_WIN_NULL) {
+        MPI_Win_sync(halo->win);
+        atomic_store_explicit(halo->ready, layer, memory_order_release);
+    }
+}
+
+// Read the boundary value of time layer 'layer' from the neighbour on 'side'
+static double halo_read_peer(Halo *halo, int side, const double *u, long layer) {
+    while (atomic_load_explicit(halo->peer_ready[side], memory_order_acquire) < layer) {
+        sched_yield();   // the neighbour is at most one step behind
+    }
+    MPI_Win_sync(halo->win);
+    
+    // Same slot as u in our own window; the left neighbour's last owned
+    // point sits before its right ghost cell, the right one's first owned
+    // point right after its left ghost cell
+    long slot = (u - halo->layers) / halo->local_size;
+    const double *v = halo->peer[side] + slot * halo->peer_size[side];
+    return (side == 0) ? v[halo->peer_size[side] - 2] : v[1];
+}
+
+// Fill the ghost cells of u (time layer 'layer', local_size values, ghost
+// cells at the ends)
+void halo_exchange(Halo *halo, double *u, long layer, int local_size, int ghost_left, int ghost_right) {
+    halo->send[0] = u[ghost_left];
+    halo->send[1] = u[local_size - ghost_right - 1];
+    
+    MPI_Startall(halo->count, halo->requests);
+    
+    // Neighbours on this node are read while the messages are in flight
+    if (ghost_left && halo->shared[0]) {
+        u[0] = halo_read_peer(halo, 0, u, layer);
+    }
+    if (ghost_right && halo->shared[1]) {
+        u[local_size - 1] = halo_read_peer(halo, 1, u, layer);
+    }
+    
+    MPI_Waitall(halo->count, halo->requests, MPI_STATUSES_IGNORE);
+    
+    if (ghost_left && !halo->shared[0]) {
+        u[0] = halo->recv[0];
+    }
+    if (ghost_right && !halo->shared[1]) {
+        u[local_size - 1] = halo->recv[1];
+    }
+}
 
-    if (argc == 3) {
-        K = atoi(argv[1]);
-        M = atoi(argv[2]);
+void halo_free(Halo *halo) {
+    for (int i = 0; i < halo->count; i++) {
+        MPI_Request_free(&halo->requests[i]);
+    }
+    if (halo->win != MPI_WIN_NULL) {
+        // Nobody may still be reading our layers
+        MPI_Barrier(halo->node);
+        MPI_Win_unlock_all(halo->win);
+        MPI_Win_free(&halo->win);
+        MPI_Comm_free(&halo->node);
+    } else {
+        free(halo->layers);
     }
+}
+
+// Snapshot in flight: every rank copies its part of the layer into 'stage'
+// and starts MPI_Igatherv, so the solver keeps stepping while it drains.
+// Rank 0 appends finished snapshots to a binary spool file, which keeps its
+// memory at SNAPSHOT_SLOTS layers no matter how many snapshots are taken.
+typedef struct {
+    double *stage;        // local part of the layer (send buffer)
+    double *gathered;     // whole layer on rank 0 (receive buffer)
+    MPI_Request request;
+    int index;            // snapshot number, -1 while the slot is free
+} SnapshotSlot;
 
+// Wait for the gather in 'slot' and store the snapshot in the spool (rank 0)
+void snapshot_finish(SnapshotSlot *slot, FILE *spool, int M) {
+    if (slot->index < 0) {
+        return;
+    }
+    
+    MPI_Wait(&slot->request, MPI_STATUS_IGNORE);
+    
+    if (spool != NULL) {
+        fseek(spool, (long)slot->index * (M + 1) * sizeof(double), SEEK_SET);
+        fwrite(slot->gathered, sizeof(double), M + 1, spool);
+    }
+    slot->index = -1;
+}
+
+// Copy the local layer into a staging slot and start gathering it to rank 0
+void snapshot_start(SnapshotSlot *slot, int index, const double *layer, int local_count,
+                    int *recvcounts, int *displs) {
+    for (int i = 0; i < local_count; i++) {
+        slot->stage[i] = layer[i];
+    }
+    slot->index = index;
+    MPI_Igatherv(slot->stage, local_count, MPI_DOUBLE,
+                 slot->gathered, recvcounts, displs, MPI_DOUBLE,
+                 0, MPI_COMM_WORLD, &slot->request);
+}
+
+// Write this rank's part of snapshot 'index' into the binary file (collective)
+void binary_snapshot_write(MPI_File fh, const BinaryHeader *hdr, int index,
+                           const double *layer, int local_start, int local_count) {
+    MPI_Offset offset = hdr->header_bytes + hdr->capacity * sizeof(double) +
+                        ((MPI_Offset)index * hdr->npoints + local_start) * sizeof(double);
+    MPI_File_write_at_all(fh, offset, layer, local_count, MPI_DOUBLE, MPI_STATUS_IGNORE);
+}
+
+// Drive outstanding gathers without blocking the time loop
+void snapshot_progress(SnapshotSlot *slots) {
+    int done;
+    for (int s = 0; s < SNAPSHOT_SLOTS; s++) {
+        if (slots[s].index >= 0) {
+            MPI_Test(&slots[s].request, &done, MPI_STATUS_IGNORE);
+        }
+    }
+}
+
+// Largest wave speed over all ranks, so they agree on the adaptive step
+double allreduce_max(double local) {
+    double global;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return global;
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size;
+    double start_time, end_time;
+    TransportConfig cfg;
+    const char *positional[] = {"K", "M", "snapshots", "output", NULL};
     
     // Initialize MPI
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     
+    // Parse the problem on rank 0 and share it with everybody
+    if (rank == 0) {
+        problem_defaults(&cfg, DEFAULT_K, DEFAULT_M);
+        if (problem_parse_args(&cfg, argc, argv, positional) != 0) {
+            printf("Usage: %s [K M [snapshots [csv|bin]]] [key=value ...] [config=file]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        problem_print(&cfg);
+    }
+    MPI_Bcast(&cfg, sizeof(cfg), MPI_BYTE, 0, MPI_COMM_WORLD);
+    
+    int K = cfg.K, M = cfg.M;
+    int num_snapshots = (cfg.snapshots < 1) ? 1 : cfg.snapshots;
+    int binary_output = cfg.binary_output;
+    double tau = cfg.t_max / K;   // time step (fixed step mode)
+    double h = cfg.x_max / M;     // space step
+    
     // Start timing (only rank 0 needs to track the total time)
     if (rank == 0) {
         start_time = MPI_Wtime();
     }
     
-    // Check stability condition for cross scheme
+    // The implicit scheme is factorized once for a constant Courant number
+    const SchemeInfo *scheme = &scheme_info[cfg.scheme];
+    if (scheme->implicit && cfg.a_amp != 0.0) {
+        if (rank == 0) {
+            printf("Scheme %s needs a constant velocity (a_amp=0)\n", scheme->name);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int adaptive = cfg.cfl > 0.0 && scheme->cfl_limit > 0.0;
+    // A three-level scheme keeps u_prev, needs a start-up step and must
+    // rescale u_prev when the step size changes
+    int three_level = scheme->levels == 3;
+    if (rank == 0 && cfg.cfl > 0.0 && !adaptive) {
+        printf("Scheme %s has no stability limit, cfl is ignored\n", scheme->name);
+    }
+    
+    // Check stability condition of the explicit schemes
+    double courant = cfg.a * tau / h;
+    double courant_max = fabs(courant) * (1.0 + fabs(cfg.a_amp));
     if (rank == 0) {
-        if (fabs(A) * tau / h > 1.0) {
-            printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", fabs(A) * tau / h);
+        if (!adaptive && scheme->cfl_limit > 0.0 && courant_max > scheme->cfl_limit) {
+            printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", courant_max);
             printf("Solution may be unstable. Consider reducing tau or increasing h.\n");
         }
+        if (adaptive && cfg.cfl > scheme->cfl_limit) {
+            printf("Warning: cfl=%g is above the stability limit %g of scheme %s\n",
+                   cfg.cfl, scheme->cfl_limit, scheme->name);
+        }
     }
     
+    TimeStepper step;
+    stepper_init(&step, &cfg, h, num_snapshots, adaptive, allreduce_max);
+    
     // Calculate domain decomposition
     // Each process handles a portion of the spatial domain
     int points_per_proc = (M + 1) / size;
@@ -85,79 +395,69 @@ int main(int argc, char *argv[]) {
     int local_size = local_count + ghost_cells_left + ghost_cells_right;
     
     // Allocate memory for solution
-    // We need to store 3 time layers (prev, current, next)
-    double *u_prev = (double *)malloc(local_size * sizeof(double));
-    double *u_curr = (double *)malloc(local_size * sizeof(double));
-    double *u_next = (double *)malloc(local_size * sizeof(double));
+    // We need to store 3 time layers (prev, current, next), they belong to
+    // the halo exchange because in shared mode the neighbours read them
+    Halo halo;
+    double *layers = halo_setup(&halo, local_size, rank, size, cfg.shared_halo);
+    double *u_curr = layers;
+    double *u_prev = layers + local_size;
+    double *u_next = layers + 2 * local_size;
     
-    // Initialize solution - set initial condition at t=0
-    for (int i = 0; i < local_size; i++) {
-        // Convert local index to global
-        int global_idx = local_start + i - ghost_cells_left;
-        
-        // Initialize with proper initial condition
-        if (i >= ghost_cells_left && i < local_size - ghost_cells_right) {
-            u_prev[i] = phi(global_idx * h);
+    if (cfg.shared_halo) {
+        int shared_links = 0;
+        MPI_Reduce(&halo.shared[1], &shared_links, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            printf("Halo exchange: %d of %d neighbour links through shared memory\n", shared_links, size - 1);
         }
     }
     
-    // Set boundary condition at x=0 (only for process 0)
+    // Initialize solution - set initial condition at t=0
+    problem_tabulate_phi(&cfg, local_start, local_count, h, &u_curr[ghost_cells_left]);
+    
+    // Boundary values for every time level of the fixed step (only process
+    // 0 owns x=0); the adaptive step evaluates psi as it goes
+    double *psi_table = NULL;
     if (rank == 0) {
-        u_prev[ghost_cells_left] = psi(0);
+        psi_table = adaptive ? NULL : problem_tabulate_psi(&cfg, tau);
+        u_curr[ghost_cells_left] = problem_psi(&cfg, 0.0);
     }
     
-    // Communication buffers for ghost cells
-    double send_buf, recv_buf;
-    MPI_Status status;
-    
-    // First time step calculation (t=1)
-    // Exchange ghost cells for t=0 layer
-    if (rank > 0) {
-        // Send leftmost point to left neighbor
-        send_buf = u_prev[ghost_cells_left];
-        MPI_Send(&send_buf, 1, MPI_DOUBLE, rank-1, 0, MPI_COMM_WORLD);
-        
-        // Receive from left neighbor
-        MPI_Recv(&recv_buf, 1, MPI_DOUBLE, rank-1, 0, MPI_COMM_WORLD, &status);
-        u_prev[0] = recv_buf;
+    // Steady sources are evaluated once per local point
+    double *source = NULL;
+    if (problem_source_is_steady(&cfg)) {
+        source = (double *)malloc(local_size * sizeof(double));
+        problem_tabulate_source(&cfg, local_start - ghost_cells_left, local_size, h, source);
     }
     
-    if (rank < size - 1) {
-        // Send rightmost point to right neighbor
-        send_buf = u_prev[local_size - ghost_cells_right - 1];
-        MPI_Send(&send_buf, 1, MPI_DOUBLE, rank+1, 0, MPI_COMM_WORLD);
-        
-        // Receive from right neighbor
-        MPI_Recv(&recv_buf, 1, MPI_DOUBLE, rank+1, 0, MPI_COMM_WORLD, &status);
-        u_prev[local_size - 1] = recv_buf;
-    }
+    // Points updated by the scheme: everything owned except x=0 on process 0.
+    // The explicit schemes stop at interior_end and leave x=X to the
+    // zero-gradient outflow condition, the same one seq_test.c applies.
+    int first_point = ghost_cells_left + ((rank == 0) ? 1 : 0);
+    int last_point = local_size - ghost_cells_right;
+    int interior_end = last_point - ((rank == size - 1) ? 1 : 0);
+    int global_offset = local_start - ghost_cells_left;
     
-    // Calculate first time step (t=1) using forward time, central space scheme
-    for (int i = ghost_cells_left; i < local_size - ghost_cells_right; i++) {
-        if (i == ghost_cells_left && rank == 0) {
-            // Left boundary condition
-            u_curr[i] = psi(tau);
-        } else {
-            // Interior points (and right boundary for last process)
-            int global_idx = local_start + i - ghost_cells_left;
-            double x = global_idx * h;
-            
-            // Forward time, central space scheme for first time step
-            u_curr[i] = u_prev[i] - A * tau / (2 * h) * (u_prev[i+1] - u_prev[i-1]) + tau * f(0, x);
-        }
+    // Implicit scheme: distributed tridiagonal system, factorized once
+    CrankNicolson cn;
+    if (cfg.scheme == SCHEME_CRANK_NICOLSON) {
+        cn_setup(&cn, courant, local_start, local_count, M, MPI_COMM_WORLD);
     }
     
+    halo_publish(&halo, 0);
+    
     // Allocate memory for snapshots collection
-    double *global_solution = NULL;
     int *recvcounts = NULL;
     int *displs = NULL;
+    FILE *spool = NULL;
+    SnapshotSlot slots[SNAPSHOT_SLOTS];
+    int next_slot = 0;
+    int snapshots_taken = 0;
     
     if (rank == 0) {
-        global_solution = (double *)malloc((M + 1) * sizeof(double));
         recvcounts = (int *)malloc(size * sizeof(int));
         displs = (int *)malloc(size * sizeof(int));
         
-        // Calculate recvcounts and displacements for MPI_Gatherv
+        // Calculate recvcounts and displacements for MPI_Igatherv
         for (int i = 0; i < size; i++) {
             recvcounts[i] = (M + 1) / size;
             if (i < remainder) {
@@ -166,81 +466,138 @@ int main(int argc, char *argv[]) {
             
             displs[i] = (i == 0) ? 0 : displs[i-1] + recvcounts[i-1];
         }
+        
+        if (!binary_output) {
+            spool = fopen(SNAPSHOT_SPOOL, "w+b");
+            if (!spool) {
+                printf("Error opening snapshot spool file\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
     }
     
-    // Collect initial solution (t=0) for output
-    MPI_Gatherv(&u_prev[ghost_cells_left], local_count, MPI_DOUBLE,
-                global_solution, recvcounts, displs, MPI_DOUBLE,
-                0, MPI_COMM_WORLD);
+    for (int s = 0; s < SNAPSHOT_SLOTS; s++) {
+        slots[s].stage = (double *)malloc(local_count * sizeof(double));
+        slots[s].gathered = (rank == 0) ? (double *)malloc((M + 1) * sizeof(double)) : NULL;
+        slots[s].index = -1;
+    }
     
-    // Store snapshots in memory (only on rank 0)
-    double **snapshots = NULL;
-    if (rank == 0) {
-        snapshots = (double **)malloc((NUM_SNAPSHOTS + 1) * sizeof(double *));
-        for (int s = 0; s <= NUM_SNAPSHOTS; s++) {
-            snapshots[s] = (double *)malloc((M + 1) * sizeof(double));
+    // Binary output: collective file, header and time table written at the end
+    MPI_File binfile = MPI_FILE_NULL;
+    BinaryHeader bin_header;
+    double *snapshot_times = NULL;
+    
+    if (binary_output) {
+        memset(&bin_header, 0, sizeof(bin_header));
+        memcpy(bin_header.magic, BINARY_MAGIC, sizeof(bin_header.magic));
+        bin_header.version = BINARY_VERSION;
+        bin_header.header_bytes = sizeof(BinaryHeader);
+        bin_header.npoints = M + 1;
+        bin_header.capacity = num_snapshots + 1;
+        bin_header.h = h;
+        bin_header.tau = tau;
+        bin_header.a = cfg.a;
+        
+        if (MPI_File_open(MPI_COMM_WORLD, BINARY_OUTPUT, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                          MPI_INFO_NULL, &binfile) != MPI_SUCCESS) {
+            if (rank == 0) {
+                printf("Error opening output file\n");
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        MPI_File_set_size(binfile, 0);
         
-        // Store initial solution as first snapshot
-        for (int i = 0; i <= M; i++) {
-            snapshots[0][i] = global_solution[i];
+        if (rank == 0) {
+            snapshot_times = (double *)calloc(num_snapshots + 1, sizeof(double));
         }
     }
     
-    // Main time stepping loop
-    for (int k = 1; k < K; k++) {
+    // Collect initial solution (t=0) as the first snapshot
+    if (binary_output) {
+        binary_snapshot_write(binfile, &bin_header, 0, &u_curr[ghost_cells_left], local_start, local_count);
+    } else {
+        snapshot_start(&slots[next_slot], 0, &u_curr[ghost_cells_left], local_count, recvcounts, displs);
+        next_slot = (next_slot + 1) % SNAPSHOT_SLOTS;
+    }
+    snapshots_taken = 1;
+    
+    // Main time stepping loop: layer k at time t to layer k+1 at t + tau.
+    // The three-level cross scheme needs the layer one step back: at t=0
+    // and when the adaptive step grows it starts again with forward time,
+    // central space; when the step shrinks the layer t - tau lies between
+    // the two it has and is interpolated, which adds no amplification. The
+    // two-level schemes simply take their own step.
+    for (; !stepper_done(&step); stepper_advance(&step)) {
+        int k = step.k;
+        
         // Exchange ghost cells for current time layer
-        if (rank > 0) {
-            // Send leftmost point to left neighbor
-            send_buf = u_curr[ghost_cells_left];
-            MPI_Send(&send_buf, 1, MPI_DOUBLE, rank-1, 0, MPI_COMM_WORLD);
-            
-            // Receive from left neighbor
-            MPI_Recv(&recv_buf, 1, MPI_DOUBLE, rank-1, 0, MPI_COMM_WORLD, &status);
-            u_curr[0] = recv_buf;
-        }
+        trace_begin("halo");
+        halo_exchange(&halo, u_curr, k, local_size, ghost_cells_left, ghost_cells_right);
+        trace_end();
         
-        if (rank < size - 1) {
-            // Send rightmost point to right neighbor
-            send_buf = u_curr[local_size - ghost_cells_right - 1];
-            MPI_Send(&send_buf, 1, MPI_DOUBLE, rank+1, 0, MPI_COMM_WORLD);
-            
-            // Receive from right neighbor
-            MPI_Recv(&recv_buf, 1, MPI_DOUBLE, rank+1, 0, MPI_COMM_WORLD, &status);
-            u_curr[local_size - 1] = recv_buf;
+        trace_begin("gather");
+        snapshot_progress(slots);
+        trace_end();
+        
+        stepper_next(&step, &cfg);
+        double t = step.t;
+        tau = step.tau;
+        double t_next = step.adaptive ? step.t + tau : (k + 1) * tau;
+        double psi_next = 0.0;
+        if (rank == 0) {
+            psi_next = psi_table ? psi_table[k+1] : problem_psi(&cfg, t_next);
         }
         
-        // Calculate next time step (t=k+1) using cross scheme
-        for (int i = ghost_cells_left; i < local_size - ghost_cells_right; i++) {
-            if (i == ghost_cells_left && rank == 0) {
-                // Left boundary condition
-                u_next[i] = psi((k+1) * tau);
-            } else {
-                // Interior points (and right boundary for last process)
-                int global_idx = local_start + i - ghost_cells_left;
-                double x = global_idx * h;
-                
-                // Cross scheme for next time step
-                u_next[i] = u_prev[i] - A * tau / h * (u_curr[i+1] - u_curr[i-1]) + 
-                           2 * tau * f(k * tau, x);
+        // Calculate next time step (t=k+1) with the selected scheme
+        trace_begin("compute");
+        if (three_level && step.restart && k > 0 && step.ratio < 1.0) {
+            for (int i = 0; i < local_size; i++) {
+                u_prev[i] = u_curr[i] + step.ratio * (u_prev[i] - u_curr[i]);
             }
+            step.restart = 0;
+        }
+        if (three_level && step.restart) {
+            central_step(&cfg, u_next, u_curr, u_curr, source, first_point, interior_end, global_offset,
+                         problem_velocity(&cfg, t + 0.5 * tau) * tau / (2 * h), tau, t, h);
+            outflow_boundary(u_next, interior_end, local_start, local_count, M);
+        } else if (three_level) {
+            central_step(&cfg, u_next, u_prev, u_curr, source, first_point, interior_end, global_offset,
+                         problem_velocity(&cfg, t) * tau / h, 2 * tau, t, h);
+            outflow_boundary(u_next, interior_end, local_start, local_count, M);
+        } else {
+            scheme_step(&cfg, &cn, u_next, u_curr, source, first_point, interior_end, global_offset,
+                        ghost_cells_left, local_start, local_count, M, psi_next,
+                        problem_velocity(&cfg, t + 0.5 * tau) * tau / h, tau, t, h);
+        }
+        if (rank == 0) {
+            // Left boundary condition
+            u_next[ghost_cells_left] = psi_next;
         }
+        halo_publish(&halo, k + 1);
+        trace_end();
         
         // Save snapshots at specified intervals
-        if (k % (K / NUM_SNAPSHOTS) == 0) {
-            int snapshot_idx = k / (K / NUM_SNAPSHOTS);
+        if (step.output > 0) {
+            int snapshot_idx = step.output;
             
-            // Collect solution for this snapshot
-            MPI_Gatherv(&u_next[ghost_cells_left], local_count, MPI_DOUBLE,
-                        global_solution, recvcounts, displs, MPI_DOUBLE,
-                        0, MPI_COMM_WORLD);
-            
-            // Store snapshot in memory (only on rank 0)
-            if (rank == 0) {
-                for (int i = 0; i <= M; i++) {
-                    snapshots[snapshot_idx][i] = global_solution[i];
+            trace_begin(binary_output ? "io" : "gather");
+            if (binary_output) {
+                binary_snapshot_write(binfile, &bin_header, snapshot_idx, &u_next[ghost_cells_left],
+                                      local_start, local_count);
+                if (rank == 0) {
+                    snapshot_times[snapshot_idx] = t_next;
                 }
+            } else {
+                SnapshotSlot *slot = &slots[next_slot];
+                
+                // Reuse the oldest slot once its gather has drained
+                snapshot_finish(slot, spool, M);
+                snapshot_start(slot, snapshot_idx, &u_next[ghost_cells_left], local_count,
+                               recvcounts, displs);
+                next_slot = (next_slot + 1) % SNAPSHOT_SLOTS;
             }
+            trace_end();
+            snapshots_taken++;
         }
         
         // Rotate time layers (prev <- curr <- next)
@@ -250,42 +607,109 @@ int main(int argc, char *argv[]) {
         u_next = temp;
     }
     
-    // Write all snapshots to file (only on rank 0)
+    double t_final = step.t;
+    K = step.k;
+    if (rank == 0 && adaptive) {
+        printf("Adaptive step: %d steps, %d restarts, tau %.4e .. %.4e (cfl %g)\n",
+               K, step.restarts, step.tau_min, step.tau_max, cfg.cfl);
+    }
+    
+    // Error against the exact solution on the last layer (u_curr after the rotation)
+    double err_local[2] = {0.0, 0.0};   // sum of squares, max
+    int have_exact = problem_error(&cfg, t_final, local_start, local_count, h, &u_curr[ghost_cells_left],
+                                   &err_local[0], &err_local[1]);
+    double err_sq = 0.0, err_max = 0.0;
+    MPI_Reduce(&err_local[0], &err_sq, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&err_local[1], &err_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
     if (rank == 0) {
+        if (have_exact) {
+            printf("Error at t=%g: L2=%.10e Linf=%.10e\n", t_final, sqrt(h * err_sq), err_max);
+        } else {
+            printf("Error at t=%g: no exact solution for this problem\n", t_final);
+        }
+    }
+    
+    // Drain the snapshots still in flight, oldest first
+    trace_begin("gather");
+    for (int s = 0; s < SNAPSHOT_SLOTS; s++) {
+        snapshot_finish(&slots[(next_slot + s) % SNAPSHOT_SLOTS], spool, M);
+    }
+    trace_end();
+    
+    // Output files
+    trace_begin("io");
+    
+    // Binary output: rank 0 completes the header and the time table
+    if (binary_output) {
+        if (rank == 0) {
+            bin_header.nsnapshots = snapshots_taken;
+            if (adaptive) {
+                bin_header.tau = t_final / K;   // mean step
+            }
+            MPI_File_write_at(binfile, 0, &bin_header, sizeof(bin_header), MPI_BYTE, MPI_STATUS_IGNORE);
+            MPI_File_write_at(binfile, bin_header.header_bytes, snapshot_times, num_snapshots + 1,
+                              MPI_DOUBLE, MPI_STATUS_IGNORE);
+            free(snapshot_times);
+        }
+        MPI_File_close(&binfile);
+        
+        if (rank == 0) {
+            printf("Solution saved to %s\n", BINARY_OUTPUT);
+        }
+    }
+    
+    // Write saved snapshots to file (only on rank 0), streaming from the spool
+    if (rank == 0 && !binary_output) {
         FILE *outfile = fopen("transport_solution_multiple_mpi.csv", "w");
         if (!outfile) {
             printf("Error opening output file\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
         
+        int num_save = (snapshots_taken < NUM_SNAP_SAVE + 1) ? snapshots_taken : NUM_SNAP_SAVE + 1;
+        double *chunk = (double *)malloc(num_save * CSV_CHUNK_ROWS * sizeof(double));
+        
         // Write header
         fprintf(outfile, "x");
-        for (int s = 0; s <= NUM_SNAPSHOTS; s++) {
+        for (int s = 0; s <= num_snapshots; s++) {
             fprintf(outfile, ",t_%d", s);
         }
         fprintf(outfile, "\n");
         
-        // Write all snapshots
-        for (int i = 0; i <= M; i++) {
-            fprintf(outfile, "%f", i * h);
-            for (int s = 0; s <= NUM_SNAP_SAVE; s++) {
-                fprintf(outfile, ",%f", snapshots[s][i]);
+        // Write saved snapshots block by block
+        for (int row = 0; row <= M; row += CSV_CHUNK_ROWS) {
+            int rows = (M + 1 - row < CSV_CHUNK_ROWS) ? M + 1 - row : CSV_CHUNK_ROWS;
+            
+            for (int s = 0; s < num_save; s++) {
+                fseek(spool, ((long)s * (M + 1) + row) * sizeof(double), SEEK_SET);
+                if (fread(&chunk[s * CSV_CHUNK_ROWS], sizeof(double), rows, spool) != (size_t)rows) {
+                    printf("Error reading snapshot spool file\n");
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            }
+            
+            for (int i = 0; i < rows; i++) {
+                fprintf(outfile, "%f", (row + i) * h);
+                for (int s = 0; s < num_save; s++) {
+                    fprintf(outfile, ",%f", chunk[s * CSV_CHUNK_ROWS + i]);
+                }
+                fprintf(outfile, "\n");
             }
-            fprintf(outfile, "\n");
         }
         
         fclose(outfile);
         printf("Solution saved to transport_solution_multiple_mpi.csv\n");
         
-        // Free snapshot memory
-        for (int s = 0; s <= NUM_SNAPSHOTS; s++) {
-            free(snapshots[s]);
-        }
-        free(snapshots);
-        
+        free(chunk);
+        fclose(spool);
+        remove(SNAPSHOT_SPOOL);
+    }
+    trace_end();
+    
+    if (rank == 0) {
         // Calculate and print execution time
         end_time = MPI_Wtime();
-        printf("Total execution time: %.4f seconds\n", end_time - start_time);
+        printf("Total execution time: %.4f seconds (scheme %s)\n", end_time - start_time, scheme->name);
         double exec_time = end_time - start_time;
         
         // Выводим время выполнения в стандартный формат для удобства сбора данных
@@ -311,12 +735,19 @@ int main(int argc, char *argv[]) {
 
     
     // Cleanup
-    free(u_prev);
-    free(u_curr);
-    free(u_next);
+    halo_free(&halo);
+    free(source);
+    free(psi_table);
+    if (cfg.scheme == SCHEME_CRANK_NICOLSON) {
+        cn_free(&cn);
+    }
+    
+    for (int s = 0; s < SNAPSHOT_SLOTS; s++) {
+        free(slots[s].stage);
+        free(slots[s].gathered);
+    }
     
     if (rank == 0) {
-        free(global_solution);
         free(recvcounts);
         free(displs);
     }
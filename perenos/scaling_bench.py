@@ -0,0 +1,131 @@
+import argparse
+import csv
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+# Strong and weak scaling benchmark of parr_test_full.c
+#
+# strong: fixed K and M, every process count from --procs (always including 1,
+#         so speedup is measured against a real T(1) and not estimated)
+# weak:   fixed number of points per rank, M + 1 = points * p
+#
+# Every configuration is run --warmup times without recording and then
+# --repeats times. Raw times go to scaling_raw.csv, the consolidated table
+# with min / median / mean / stddev, speedup, efficiency and the Karp-Flatt
+# serial fraction goes to scaling_summary.csv, which analyze_all_results.py
+# picks up.
+#
+# Usage: python3 scaling_bench.py [--procs 1,2,4,8] [--strong 20000x10000,...]
+#                                 [--weak-points 5000] [--weak-K 20000]
+#                                 [--repeats 5] [--warmup 1] [key=value ...]
+
+RESULT_LINE = re.compile(r'^(\d+),(\d+),(\d+),([0-9.]+)$', re.MULTILINE)
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+parser = argparse.ArgumentParser(description='Strong/weak scaling benchmark of the MPI transport solver')
+parser.add_argument('--procs', default='1,2,4,8', help='process counts')
+parser.add_argument('--strong', default='20000x10000', help='KxM grids of the strong scaling series, comma separated')
+parser.add_argument('--weak-points', type=int, default=5000, help='points per rank of the weak scaling series, 0 to skip')
+parser.add_argument('--weak-K', type=int, default=20000, help='time steps of the weak scaling series')
+parser.add_argument('--repeats', type=int, default=5)
+parser.add_argument('--warmup', type=int, default=1)
+parser.add_argument('--mpirun', default='mpirun', help='MPI launcher')
+parser.add_argument('--no-build', action='store_true', help='use the existing parr_test')
+parser.add_argument('--raw', default='scaling_raw.csv')
+parser.add_argument('--output', default='scaling_summary.csv')
+args, problem = parser.parse_known_args()
+
+procs = sorted({int(p) for p in args.procs.split(',')} | {1})
+binary = os.path.join(here, 'parr_test')
+
+if not args.no_build:
+    subprocess.run(['mpicc', '-O2', 'parr_test_full.c', '-o', binary, '-lm'], cwd=here, check=True)
+
+# Solver output (CSV snapshots, benchmark_results.csv) stays in a scratch directory
+workdir = tempfile.mkdtemp(prefix='scaling_bench_')
+
+
+def run(K, M, p):
+    cmd = args.mpirun.split() + ['-np', str(p), binary, str(K), str(M)] + problem
+    proc = subprocess.run(cmd, cwd=workdir, capture_output=True, text=True)
+    found = RESULT_LINE.findall(proc.stdout)
+    if proc.returncode != 0 or not found:
+        sys.stderr.write(proc.stdout + proc.stderr)
+        sys.exit(f'Run K={K} M={M} p={p} failed')
+    return float(found[-1][3])
+
+
+configs = []
+for grid in args.strong.split(','):
+    K, M = (int(v) for v in grid.lower().split('x'))
+    configs += [('strong', K, M, p) for p in procs]
+if args.weak_points > 0:
+    configs += [('weak', args.weak_K, args.weak_points * p - 1, p) for p in procs]
+
+raw = []
+for series, K, M, p in configs:
+    print(f'{series}: K={K}, M={M}, {p} processes...', flush=True)
+    for _ in range(args.warmup):
+        run(K, M, p)
+    for r in range(args.repeats):
+        raw.append({'series': series, 'K': K, 'M': M, 'processes': p, 'repeat': r, 'time': run(K, M, p)})
+
+shutil.rmtree(workdir, ignore_errors=True)
+
+with open(args.raw, 'w', newline='') as fp:
+    writer = csv.DictWriter(fp, fieldnames=['series', 'K', 'M', 'processes', 'repeat', 'time'])
+    writer.writeheader()
+    writer.writerows(raw)
+
+# Statistics per configuration
+summary = []
+for series, K, M, p in configs:
+    times = [r['time'] for r in raw if (r['series'], r['K'], r['M'], r['processes']) == (series, K, M, p)]
+    summary.append({
+        'series': series, 'K': K, 'M': M, 'processes': p, 'runs': len(times),
+        'time_min': min(times),
+        'time_median': statistics.median(times),
+        'time_mean': statistics.mean(times),
+        'time_std': statistics.stdev(times) if len(times) > 1 else 0.0,
+    })
+
+# Speedup and efficiency from the median against the real single-process run.
+# strong: S = T(1) / T(p), E = S / p, Karp-Flatt e = (1/S - 1/p) / (1 - 1/p)
+# weak:   E = T(1) / T(p), the work per rank stays the same
+for row in summary:
+    if row['series'] == 'strong':
+        base = next(b for b in summary if b['series'] == 'strong' and b['processes'] == 1
+                    and (b['K'], b['M']) == (row['K'], row['M']))
+        p = row['processes']
+        speedup = base['time_median'] / row['time_median']
+        row['speedup'] = speedup
+        row['efficiency'] = speedup / p
+        row['karp_flatt'] = (1 / speedup - 1 / p) / (1 - 1 / p) if p > 1 else ''
+    else:
+        base = next(b for b in summary if b['series'] == 'weak' and b['processes'] == 1)
+        row['speedup'] = row['processes'] * base['time_median'] / row['time_median']
+        row['efficiency'] = base['time_median'] / row['time_median']
+        row['karp_flatt'] = ''
+
+fields = ['series', 'K', 'M', 'processes', 'runs', 'time_min', 'time_median', 'time_mean', 'time_std',
+          'speedup', 'efficiency', 'karp_flatt']
+with open(args.output, 'w', newline='') as fp:
+    writer = csv.DictWriter(fp, fieldnames=fields)
+    writer.writeheader()
+    for row in summary:
+        writer.writerow({k: (f'{v:.6g}' if isinstance(v, float) else v) for k, v in row.items()})
+
+print(f'\n{"series":>6} {"K":>7} {"M":>8} {"p":>3} {"min":>8} {"median":>8} {"std":>8} '
+      f'{"S":>6} {"E":>6} {"e_KF":>7}')
+for row in summary:
+    kf = f'{row["karp_flatt"]:.4f}' if row['karp_flatt'] != '' else '-'
+    print(f'{row["series"]:>6} {row["K"]:>7} {row["M"]:>8} {row["processes"]:>3} '
+          f'{row["time_min"]:>8.4f} {row["time_median"]:>8.4f} {row["time_std"]:>8.4f} '
+          f'{row["speedup"]:>6.2f} {row["efficiency"]:>6.2f} {kf:>7}')
+print(f'\nRaw times saved to {args.raw}, summary saved to {args.output}')
@@ -1,92 +1,165 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <time.h>
 
-// Parameters for the transport equation
-#define A 1.0         // coefficient 'a' in the equation
-#define T 1.0         // max time
-#define X 1.0         // max x coordinate
-#define K 1000        // number of time steps
-#define M 100         // number of space steps
-#define NUM_SNAPSHOTS 9  // Number of time snapshots to save
-#define NUM_SNAP_SAVE 3
-
-// Initial and boundary conditions
-double phi(double x) {
-    // Example: initial condition u(0,x) = gaussian pulse
-    return exp(-(x - X / 2) * (x - X / 2) * 100);
-}
+#include "transport_problem.h"
+#include "transport_stepper.h"
 
-double psi(double t) {
-    // Example: boundary condition u(t,0) = 0
-    return 0.0;
-}
+// The problem (a, T, X, phi, psi, f) is configured at runtime, see
+// transport_problem.h; defaults reproduce the gaussian pulse with a = 1
+#define DEFAULT_K 1000    // number of time steps
+#define DEFAULT_M 100     // number of space steps
+#define NUM_SNAP_SAVE 3
 
-double f(double t, double x) {
-    // Example: source term f(t,x) = 0
-    return 0.0;
-}
+int main(int argc, char *argv[]) {
+    TransportConfig cfg;
+    const char *positional[] = {"K", "M", NULL};
+    
+    problem_defaults(&cfg, DEFAULT_K, DEFAULT_M);
+    if (problem_parse_args(&cfg, argc, argv, positional) != 0) {
+        printf("Usage: %s [K M] [key=value ...] [config=file]\n", argv[0]);
+        return 1;
+    }
+    if (cfg.scheme != SCHEME_CROSS) {
+        printf("Only the cross scheme is implemented here (scheme=cross), see parr_test_full.c\n");
+        return 1;
+    }
+    problem_print(&cfg);
+    
+    int K = cfg.K, M = cfg.M;
+    int num_snapshots = (cfg.snapshots < 1) ? 1 : cfg.snapshots;
+    int adaptive = cfg.cfl > 0.0;
 
-int main() {
-    clock_t start_time, end_time;
-    double cpu_time_used;
+    // Wall-clock time, comparable with MPI_Wtime() of the parallel version
+    // (clock() counts CPU time)
+    struct timespec start_time, end_time;
+    double wall_time_used;
     
-    start_time = clock(); // Засекаем время начала выполнения
+    clock_gettime(CLOCK_MONOTONIC, &start_time); // Засекаем время начала выполнения
     
-    double tau = T / K;       // time step
-    double h = X / M;         // space step
+    double tau = cfg.t_max / K;   // time step (fixed step mode)
+    double h = cfg.x_max / M;     // space step
     
     // Check stability condition for cross scheme
     // For the cross scheme, the CFL condition is |a|*tau/h <= 1
-    if (fabs(A) * tau / h > 1.0) {
-        printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", fabs(A) * tau / h);
+    double courant_max = fabs(cfg.a) * tau / h * (1.0 + fabs(cfg.a_amp));
+    if (!adaptive && courant_max > 1.0) {
+        printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", courant_max);
         printf("Solution may be unstable. Consider reducing tau or increasing h.\n");
     }
+    if (adaptive && cfg.cfl > 1.0) {
+        printf("Warning: cfl=%g is above the stability limit 1 of scheme cross\n", cfg.cfl);
+    }
     
-    // Allocate memory for all time layers
-    double **u = (double **)malloc((K + 1) * sizeof(double *));
-    for (int k = 0; k <= K; k++) {
-        u[k] = (double *)malloc((M + 1) * sizeof(double));
+    // The same steps as parr_test_full.c, see transport_stepper.h
+    TimeStepper step;
+    stepper_init(&step, &cfg, h, num_snapshots, adaptive, NULL);
+    
+    // Three time layers and the saved snapshots
+    double *u_prev = (double *)malloc((M + 1) * sizeof(double));
+    double *u_curr = (double *)malloc((M + 1) * sizeof(double));
+    double *u_next = (double *)malloc((M + 1) * sizeof(double));
+    double *snapshots[NUM_SNAP_SAVE + 1];
+    for (int i = 0; i <= NUM_SNAP_SAVE; i++) {
+        snapshots[i] = (double *)calloc(M + 1, sizeof(double));
     }
     
     // Set initial condition: u(0,x) = phi(x)
-    for (int m = 0; m <= M; m++) {
-        u[0][m] = phi(m * h);
-    }
+    problem_tabulate_phi(&cfg, 0, M + 1, h, u_curr);
     
-    // Set boundary condition: u(t,0) = psi(t)
-    for (int k = 0; k <= K; k++) {
-        u[k][0] = psi(k * tau);
-    }
+    // Set boundary condition: u(t,0) = psi(t), tabulated for the fixed step
+    double *psi_table = adaptive ? NULL : problem_tabulate_psi(&cfg, tau);
+    u_curr[0] = problem_psi(&cfg, 0.0);
+    memcpy(snapshots[0], u_curr, (M + 1) * sizeof(double));
     
-    // We need to compute the first time layer (k=1) using another method
-    // Here we'll use a first-order forward time, central space scheme
-    for (int m = 1; m < M; m++) {
-        u[1][m] = u[0][m] - A * tau / (2 * h) * (u[0][m+1] - u[0][m-1]) + tau * f(0, m * h);
+    // Fixed step: layers saved as snapshots
+    int snapshot_steps[NUM_SNAP_SAVE + 1];
+    for (int i = 0; i <= NUM_SNAP_SAVE; i++) {
+        snapshot_steps[i] = i * K / num_snapshots;
     }
     
-    // Set boundary condition at right end (x=X) for all time steps
-    for (int k = 0; k <= K; k++) {
-        // You can use different boundary conditions at x=X if needed
-        // For now, we'll use a simple extrapolation (zero gradient)
-        u[k][M] = u[k][M-1];
+    // Steady sources are evaluated once per point
+    double *source = NULL;
+    if (problem_source_is_steady(&cfg)) {
+        source = (double *)malloc((M + 1) * sizeof(double));
+        problem_tabulate_source(&cfg, 0, M + 1, h, source);
     }
     
     // Solve using Cross scheme (central differences in time and space)
     // (u^(k+1)_m - u^(k-1)_m)/(2*τ) + a*(u^k_(m+1) - u^k_(m-1))/(2*h) = f^k_m
-    for (int k = 1; k < K; k++) {
-        for (int m = 1; m < M; m++) {
-            u[k+1][m] = u[k-1][m] - A * tau / h * (u[k][m+1] - u[k][m-1]) + 2 * tau * f(k * tau, m * h);
+    // Zero-source problems keep the plain loop without any source evaluation.
+    // The first layer (and the first one after the adaptive step grows) is
+    // computed with a first-order forward time, central space scheme; when
+    // the step shrinks, the layer one step back is interpolated instead
+    for (; !stepper_done(&step); stepper_advance(&step)) {
+        int k = step.k;
+        stepper_next(&step, &cfg);
+        double t = step.t;
+        tau = step.tau;
+        double t_next = adaptive ? t + tau : (k + 1) * tau;
+        
+        if (step.restart && k > 0 && step.ratio < 1.0) {
+            for (int m = 0; m <= M; m++) {
+                u_prev[m] = u_curr[m] + step.ratio * (u_prev[m] - u_curr[m]);
+            }
+            step.restart = 0;
         }
-        // Update boundary at right end after each time step
-        u[k+1][M] = u[k+1][M-1];
+        
+        if (step.restart) {
+            double c = problem_velocity(&cfg, t + 0.5 * tau) * tau / (2 * h);
+            for (int m = 1; m < M; m++) {
+                double fm = source ? source[m] : problem_f(&cfg, t, m * h);
+                u_next[m] = u_curr[m] - c * (u_curr[m+1] - u_curr[m-1]) + tau * fm;
+            }
+        } else {
+            double c = problem_velocity(&cfg, t) * tau / h;
+            if (cfg.f == SOURCE_ZERO) {
+                for (int m = 1; m < M; m++) {
+                    u_next[m] = u_prev[m] - c * (u_curr[m+1] - u_curr[m-1]);
+                }
+            } else if (source != NULL) {
+                for (int m = 1; m < M; m++) {
+                    u_next[m] = u_prev[m] - c * (u_curr[m+1] - u_curr[m-1]) + 2 * tau * source[m];
+                }
+            } else {
+                for (int m = 1; m < M; m++) {
+                    u_next[m] = u_prev[m] - c * (u_curr[m+1] - u_curr[m-1]) + 2 * tau * problem_f(&cfg, t, m * h);
+                }
+            }
+        }
+        
+        // Inflow at x=0, zero-gradient outflow at x=X after each time step;
+        // u(0,X) stays phi(X), exactly like in parr_test_full.c
+        u_next[0] = psi_table ? psi_table[k+1] : problem_psi(&cfg, t_next);
+        u_next[M] = u_next[M-1];
+        
+        for (int i = 1; i <= NUM_SNAP_SAVE; i++) {
+            if (adaptive ? step.output == i : k + 1 == snapshot_steps[i]) {
+                memcpy(snapshots[i], u_next, (M + 1) * sizeof(double));
+            }
+        }
+        
+        // Rotate time layers (prev <- curr <- next)
+        double *temp = u_prev;
+        u_prev = u_curr;
+        u_curr = u_next;
+        u_next = temp;
+    }
+    
+    double t_final = step.t;
+    if (adaptive) {
+        printf("Adaptive step: %d steps, %d restarts, tau %.4e .. %.4e (cfl %g)\n",
+               step.k, step.restarts, step.tau_min, step.tau_max, cfg.cfl);
     }
     
-    // Calculate time steps for snapshots
-    int snapshot_steps[NUM_SNAPSHOTS + 1];
-    for (int i = 0; i <= NUM_SNAPSHOTS; i++) {
-        snapshot_steps[i] = i * K / NUM_SNAPSHOTS;
+    // Error against the exact solution on the last time layer
+    double err_sq = 0.0, err_max = 0.0;
+    if (problem_error(&cfg, t_final, 0, M + 1, h, u_curr, &err_sq, &err_max)) {
+        printf("Error at t=%g: L2=%.10e Linf=%.10e\n", t_final, sqrt(h * err_sq), err_max);
+    } else {
+        printf("Error at t=%g: no exact solution for this problem\n", t_final);
     }
     
     // Output solution at multiple time steps to file
@@ -98,7 +171,7 @@ int main() {
     
     // Write header with time snapshots
     fprintf(fp, "x");
-    for (int i = 0; i <= NUM_SNAPSHOTS; i++) {
+    for (int i = 0; i <= num_snapshots; i++) {
         fprintf(fp, ",t_%d", i);
     }
     fprintf(fp, "\n");
@@ -109,8 +182,7 @@ int main() {
         
         // Write solution values at different time steps
         for (int i = 0; i <= NUM_SNAP_SAVE; i++) {
-            int k = snapshot_steps[i];
-            fprintf(fp, ",%f", u[k][m]);
+            fprintf(fp, ",%f", snapshots[i][m]);
         }
         fprintf(fp, "\n");
     }
@@ -119,15 +191,19 @@ int main() {
     printf("Solution data saved to transport_solution_multiple.csv\n");
     
     // Free allocated memory
-    for (int k = 0; k <= K; k++) {
-        free(u[k]);
+    for (int i = 0; i <= NUM_SNAP_SAVE; i++) {
+        free(snapshots[i]);
     }
-    free(u);
+    free(u_prev);
+    free(u_curr);
+    free(u_next);
+    free(psi_table);
+    free(source);
     
     // Вычисляем и выводим время выполнения
-    end_time = clock();
-    cpu_time_used = ((double) (end_time - start_time)) / CLOCKS_PER_SEC;
-    printf("Program execution time: %.4f seconds\n", cpu_time_used);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    wall_time_used = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) * 1e-9;
+    printf("Program execution time: %.4f seconds\n", wall_time_used);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,492 @@
+#ifndef TRANSPORT_PROBLEM_H
+#define TRANSPORT_PROBLEM_H
+
+// Runtime problem definition for the transport equation solvers
+//
+//     u_t + a * u_x = f(t,x),   0 <= t <= T,  0 <= x <= X
+//     u(0,x) = phi(x),  u(t,0) = psi(t)
+//
+// phi, psi and f are picked from a small built-in library and configured with
+// key=value pairs, either on the command line or in a parameter file:
+//
+//     ./parr_test K=20000 M=5000 phi=sine psi=zero f=const f_amp=0.5
+//     ./parr_test config=problem.cfg M=10000
+//
+// Arguments without '=' are positional and map to the keys each program
+// passes to problem_parse_args(), so old command lines like "./parr_test K M"
+// keep working. Parameter files hold one "key = value" per line, '#' starts
+// a comment. Later settings override earlier ones.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PROBLEM_LINE_MAX 256
+
+typedef enum { PHI_GAUSS, PHI_SINE, PHI_STEP, PHI_ZERO, PHI_COUNT } PhiKind;
+typedef enum { PSI_ZERO, PSI_CONST, PSI_SINE, PSI_COUNT } PsiKind;
+typedef enum { SOURCE_ZERO, SOURCE_CONST, SOURCE_SINE_X, SOURCE_SINE_TX, SOURCE_COUNT } SourceKind;
+typedef enum { SCHEME_CROSS, SCHEME_UPWIND, SCHEME_LAX_WENDROFF, SCHEME_CRANK_NICOLSON, SCHEME_COUNT } SchemeKind;
+
+static const char *phi_names[PHI_COUNT] = {"gauss", "sine", "step", "zero"};
+static const char *psi_names[PSI_COUNT] = {"zero", "const", "sine"};
+static const char *source_names[SOURCE_COUNT] = {"zero", "const", "sine_x", "sine_tx"};
+static const char *scheme_names[SCHEME_COUNT] = {"cross", "upwind", "lax_wendroff", "crank_nicolson"};
+
+typedef enum { PRECISION_DOUBLE, PRECISION_FLOAT, PRECISION_KAHAN, PRECISION_COUNT } PrecisionKind;
+static const char *precision_names[PRECISION_COUNT] = {"double", "float", "kahan"};
+
+// Plain data only, so rank 0 can parse it and broadcast it as bytes
+typedef struct {
+    // Equation and grid
+    double a;             // transport velocity
+    double a_amp;         // a(t) = a * (1 + a_amp * sin(2*pi*a_freq*t)), see problem_velocity
+    double a_freq;
+    double t_max;         // T
+    double x_max;         // X
+    int K;                // number of time steps
+    int M;                // number of space steps
+
+    // Initial condition
+    PhiKind phi;
+    double phi_amp;
+    double phi_center;    // gauss / step center
+    double phi_sharpness; // gauss: exp(-(x - center)^2 * sharpness)
+    double phi_width;     // step: half-width of the plateau
+    double phi_freq;      // sine: sin(2*pi*freq*x)
+
+    // Boundary condition at x = 0
+    PsiKind psi;
+    double psi_amp;
+    double psi_freq;
+
+    // Source term
+    SourceKind f;
+    double f_amp;
+    double f_freq;
+
+    // Difference scheme (see transport_schemes.h)
+    SchemeKind scheme;
+
+    // Multi-dimensional solver (parr_nd.c): M points per direction,
+    // velocity (a, a_y, a_z), phi(x)*phi(y)*phi(z) initial condition
+    int dim;
+    double a_y;
+    double a_z;
+    int block;            // tile edge of the cache-blocked sweeps
+
+    // Halo exchange between ranks on the same node (parr_test_full.c):
+    // 1 reads the neighbours' layers from an MPI-3 shared window
+    int shared_halo;
+
+    // Parareal (parareal.c): upwind coarse propagator at Courant number
+    // coarse_courant, iterations stop when no slice boundary moves by more
+    // than parareal_tol or after parareal_iters iterations
+    double coarse_courant;
+    int parareal_iters;
+    double parareal_tol;
+
+    // Adaptive time step (transport_stepper.h): 0 keeps tau = T/K, otherwise
+    // every step uses the largest tau with max|a| * tau / h <= cfl
+    double cfl;
+
+    // Layer storage of mixed_precision.c: double, float (float32 layers,
+    // float64 arithmetic) or kahan (float plus a compensation array)
+    PrecisionKind precision;
+
+    // Output
+    int snapshots;        // number of snapshot intervals
+    int binary_output;    // 1: collective binary file instead of CSV
+} TransportConfig;
+
+// Defaults: gaussian pulse, zero boundary, zero source, A = T = X = 1
+static inline void problem_defaults(TransportConfig *cfg, int K, int M) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->a = 1.0;
+    cfg->a_amp = 0.0;
+    cfg->a_freq = 1.0;
+    cfg->t_max = 1.0;
+    cfg->x_max = 1.0;
+    cfg->K = K;
+    cfg->M = M;
+
+    cfg->phi = PHI_GAUSS;
+    cfg->phi_amp = 1.0;
+    cfg->phi_center = 0.5;
+    cfg->phi_sharpness = 100.0;
+    cfg->phi_width = 0.1;
+    cfg->phi_freq = 1.0;
+
+    cfg->psi = PSI_ZERO;
+    cfg->psi_amp = 0.0;
+    cfg->psi_freq = 1.0;
+
+    cfg->f = SOURCE_ZERO;
+    cfg->f_amp = 0.0;
+    cfg->f_freq = 1.0;
+
+    cfg->scheme = SCHEME_CROSS;
+
+    cfg->dim = 2;
+    cfg->a_y = 1.0;
+    cfg->a_z = 1.0;
+    cfg->block = 64;
+
+    cfg->shared_halo = 0;
+
+    cfg->coarse_courant = 0.9;
+    cfg->parareal_iters = 0;      // 0: number of time slices
+    cfg->parareal_tol = 1e-10;
+
+    cfg->cfl = 0.0;
+
+    cfg->precision = PRECISION_FLOAT;
+
+    cfg->snapshots = 9;
+    cfg->binary_output = 0;
+}
+
+// Transport velocity a(t); a_amp = 0 keeps it constant
+static inline double problem_velocity(const TransportConfig *cfg, double t) {
+    if (cfg->a_amp == 0.0) {
+        return cfg->a;
+    }
+    return cfg->a * (1.0 + cfg->a_amp * sin(2.0 * M_PI * cfg->a_freq * t));
+}
+
+// Distance travelled along a characteristic from 0 to t: integral of a(t)
+static inline double problem_velocity_integral(const TransportConfig *cfg, double t) {
+    double w = 2.0 * M_PI * cfg->a_freq;
+    if (cfg->a_amp == 0.0 || w == 0.0) {
+        return cfg->a * t;
+    }
+    return cfg->a * (t + cfg->a_amp * (1.0 - cos(w * t)) / w);
+}
+
+// Initial condition u(0,x)
+static inline double problem_phi(const TransportConfig *cfg, double x) {
+    switch (cfg->phi) {
+        case PHI_GAUSS:
+            return cfg->phi_amp * exp(-(x - cfg->phi_center) * (x - cfg->phi_center) * cfg->phi_sharpness);
+        case PHI_SINE:
+            return cfg->phi_amp * sin(2.0 * M_PI * cfg->phi_freq * x);
+        case PHI_STEP:
+            return (fabs(x - cfg->phi_center) <= cfg->phi_width) ? cfg->phi_amp : 0.0;
+        default:
+            return 0.0;
+    }
+}
+
+// Boundary condition u(t,0)
+static inline double problem_psi(const TransportConfig *cfg, double t) {
+    switch (cfg->psi) {
+        case PSI_CONST:
+            return cfg->psi_amp;
+        case PSI_SINE:
+            return cfg->psi_amp * sin(2.0 * M_PI * cfg->psi_freq * t);
+        default:
+            return 0.0;
+    }
+}
+
+// Source term f(t,x)
+static inline double problem_f(const TransportConfig *cfg, double t, double x) {
+    switch (cfg->f) {
+        case SOURCE_CONST:
+            return cfg->f_amp;
+        case SOURCE_SINE_X:
+            return cfg->f_amp * sin(2.0 * M_PI * cfg->f_freq * x);
+        case SOURCE_SINE_TX:
+            return cfg->f_amp * sin(2.0 * M_PI * cfg->f_freq * (x - t));
+        default:
+            return 0.0;
+    }
+}
+
+// Sources that do not depend on t are tabulated once per point
+static inline int problem_source_is_steady(const TransportConfig *cfg) {
+    return cfg->f == SOURCE_CONST || cfg->f == SOURCE_SINE_X;
+}
+
+// phi at global points start .. start+count-1
+static inline void problem_tabulate_phi(const TransportConfig *cfg, int start, int count, double h, double *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = problem_phi(cfg, (start + i) * h);
+    }
+}
+
+// psi at every time level 0 .. K
+static inline double *problem_tabulate_psi(const TransportConfig *cfg, double tau) {
+    double *table = (double *)malloc((cfg->K + 1) * sizeof(double));
+    for (int k = 0; k <= cfg->K; k++) {
+        table[k] = problem_psi(cfg, k * tau);
+    }
+    return table;
+}
+
+// Time-independent source at global points start .. start+count-1
+static inline void problem_tabulate_source(const TransportConfig *cfg, int start, int count, double h, double *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = problem_f(cfg, 0.0, (start + i) * h);
+    }
+}
+
+// Exact solution for a > 0: follow the characteristic x - a*t = const back
+// to t = 0 (phi) or to x = 0 (psi) and integrate f along it. The right
+// boundary does not enter, information only leaves through x = X.
+// Returns 0 when there is no closed form.
+static inline int problem_exact(const TransportConfig *cfg, double t, double x, double *u) {
+    if (cfg->a <= 0.0) {
+        return 0;
+    }
+
+    // Varying velocity: only the source-free problem, with a(t) > 0 so the
+    // characteristics stay monotone; the foot on x = 0 is found by bisection
+    if (cfg->a_amp != 0.0) {
+        if (cfg->f != SOURCE_ZERO || fabs(cfg->a_amp) >= 1.0) {
+            return 0;
+        }
+        double travelled = problem_velocity_integral(cfg, t);
+        if (x - travelled >= 0.0) {
+            *u = problem_phi(cfg, x - travelled);
+            return 1;
+        }
+        double lo = 0.0, hi = t;
+        for (int i = 0; i < 100 && hi - lo > 1e-15 * t; i++) {
+            double mid = 0.5 * (lo + hi);
+            if (travelled - problem_velocity_integral(cfg, mid) > x) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        *u = problem_psi(cfg, 0.5 * (lo + hi));
+        return 1;
+    }
+
+    double t0, x0, base;
+    if (x - cfg->a * t >= 0.0) {
+        t0 = 0.0;
+        x0 = x - cfg->a * t;
+        base = problem_phi(cfg, x0);
+    } else {
+        t0 = t - x / cfg->a;
+        x0 = 0.0;
+        base = problem_psi(cfg, t0);
+    }
+    double s = t - t0;   // time spent on the characteristic
+    double w = 2.0 * M_PI * cfg->f_freq;
+
+    switch (cfg->f) {
+        case SOURCE_CONST:
+            base += cfg->f_amp * s;
+            break;
+        case SOURCE_SINE_X:
+            if (w != 0.0) {
+                base += cfg->f_amp * (cos(w * x0) - cos(w * x)) / (w * cfg->a);
+            }
+            break;
+        case SOURCE_SINE_TX: {
+            // x - t changes with speed a - 1 along the characteristic
+            double drift = cfg->a - 1.0;
+            if (w == 0.0 || fabs(drift) < 1e-12) {
+                base += cfg->f_amp * sin(w * (x0 - t0)) * s;
+            } else {
+                base += cfg->f_amp * (cos(w * (x0 - t0)) - cos(w * (x - t))) / (w * drift);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    *u = base;
+    return 1;
+}
+
+// Add the error of u at global points start .. start+count-1 and time t to
+// *sum_sq and *max_abs. Returns 0 when there is no exact solution.
+static inline int problem_error(const TransportConfig *cfg, double t, int start, int count, double h,
+                                const double *u, double *sum_sq, double *max_abs) {
+    double exact;
+    for (int i = 0; i < count; i++) {
+        if (!problem_exact(cfg, t, (start + i) * h, &exact)) {
+            return 0;
+        }
+        double e = fabs(u[i] - exact);
+        *sum_sq += e * e;
+        if (!(e <= *max_abs)) {   // lets a NaN through
+            *max_abs = e;
+        }
+    }
+    return 1;
+}
+
+static inline int problem_lookup(const char *value, const char **names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(value, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Set one parameter; returns 0 on success, -1 on an unknown key or bad value
+static inline int problem_set(TransportConfig *cfg, const char *key, const char *value) {
+    char *end;
+    double number = strtod(value, &end);
+    int is_number = (end != value && *end == '\0');
+    int kind;
+
+    if (strcmp(key, "phi") == 0) {
+        if ((kind = problem_lookup(value, phi_names, PHI_COUNT)) < 0) goto bad_value;
+        cfg->phi = (PhiKind)kind;
+        return 0;
+    }
+    if (strcmp(key, "psi") == 0) {
+        if ((kind = problem_lookup(value, psi_names, PSI_COUNT)) < 0) goto bad_value;
+        cfg->psi = (PsiKind)kind;
+        return 0;
+    }
+    if (strcmp(key, "f") == 0) {
+        if ((kind = problem_lookup(value, source_names, SOURCE_COUNT)) < 0) goto bad_value;
+        cfg->f = (SourceKind)kind;
+        return 0;
+    }
+    if (strcmp(key, "scheme") == 0) {
+        if ((kind = problem_lookup(value, scheme_names, SCHEME_COUNT)) < 0) goto bad_value;
+        cfg->scheme = (SchemeKind)kind;
+        return 0;
+    }
+    if (strcmp(key, "precision") == 0) {
+        if ((kind = problem_lookup(value, precision_names, PRECISION_COUNT)) < 0) goto bad_value;
+        cfg->precision = (PrecisionKind)kind;
+        return 0;
+    }
+    if (strcmp(key, "output") == 0) {
+        if (strcmp(value, "csv") == 0) cfg->binary_output = 0;
+        else if (strcmp(value, "bin") == 0) cfg->binary_output = 1;
+        else goto bad_value;
+        return 0;
+    }
+    if (strcmp(key, "halo") == 0) {
+        if (strcmp(value, "mpi") == 0) cfg->shared_halo = 0;
+        else if (strcmp(value, "shared") == 0) cfg->shared_halo = 1;
+        else goto bad_value;
+        return 0;
+    }
+    if (strcmp(key, "config") == 0) {
+        FILE *fp = fopen(value, "r");
+        char line[PROBLEM_LINE_MAX];
+        int line_no = 0;
+
+        if (!fp) {
+            fprintf(stderr, "Cannot open parameter file %s\n", value);
+            return -1;
+        }
+        while (fgets(line, sizeof(line), fp)) {
+            char k[PROBLEM_LINE_MAX], v[PROBLEM_LINE_MAX];
+            line_no++;
+
+            char *comment = strchr(line, '#');
+            if (comment) *comment = '\0';
+            for (char *c = line; *c; c++) {
+                if (*c == '=') *c = ' ';
+            }
+            if (sscanf(line, "%255s %255s", k, v) != 2) {
+                continue;
+            }
+            if (problem_set(cfg, k, v) != 0) {
+                fprintf(stderr, "%s:%d: invalid setting\n", value, line_no);
+                fclose(fp);
+                return -1;
+            }
+        }
+        fclose(fp);
+        return 0;
+    }
+
+    if (!is_number) goto bad_value;
+
+    if (strcmp(key, "K") == 0) cfg->K = (int)number;
+    else if (strcmp(key, "M") == 0) cfg->M = (int)number;
+    else if (strcmp(key, "A") == 0 || strcmp(key, "a") == 0) cfg->a = number;
+    else if (strcmp(key, "a_amp") == 0) cfg->a_amp = number;
+    else if (strcmp(key, "a_freq") == 0) cfg->a_freq = number;
+    else if (strcmp(key, "cfl") == 0) cfg->cfl = number;
+    else if (strcmp(key, "T") == 0) cfg->t_max = number;
+    else if (strcmp(key, "X") == 0) cfg->x_max = number;
+    else if (strcmp(key, "phi_amp") == 0) cfg->phi_amp = number;
+    else if (strcmp(key, "phi_center") == 0) cfg->phi_center = number;
+    else if (strcmp(key, "phi_sharpness") == 0) cfg->phi_sharpness = number;
+    else if (strcmp(key, "phi_width") == 0) cfg->phi_width = number;
+    else if (strcmp(key, "phi_freq") == 0) cfg->phi_freq = number;
+    else if (strcmp(key, "psi_amp") == 0) cfg->psi_amp = number;
+    else if (strcmp(key, "psi_freq") == 0) cfg->psi_freq = number;
+    else if (strcmp(key, "f_amp") == 0) cfg->f_amp = number;
+    else if (strcmp(key, "f_freq") == 0) cfg->f_freq = number;
+    else if (strcmp(key, "snapshots") == 0) cfg->snapshots = (int)number;
+    else if (strcmp(key, "dim") == 0) cfg->dim = (int)number;
+    else if (strcmp(key, "a_y") == 0) cfg->a_y = number;
+    else if (strcmp(key, "a_z") == 0) cfg->a_z = number;
+    else if (strcmp(key, "block") == 0) cfg->block = (int)number;
+    else if (strcmp(key, "coarse_courant") == 0) cfg->coarse_courant = number;
+    else if (strcmp(key, "parareal_iters") == 0) cfg->parareal_iters = (int)number;
+    else if (strcmp(key, "parareal_tol") == 0) cfg->parareal_tol = number;
+    else {
+        fprintf(stderr, "Unknown parameter '%s'\n", key);
+        return -1;
+    }
+    return 0;
+
+bad_value:
+    fprintf(stderr, "Invalid value '%s' for parameter '%s'\n", value, key);
+    return -1;
+}
+
+// Parse command line arguments; 'positional' lists the keys of arguments
+// given without '=' (NULL-terminated). Returns 0 on success.
+static inline int problem_parse_args(TransportConfig *cfg, int argc, char *argv[], const char **positional) {
+    int next_positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        char key[PROBLEM_LINE_MAX];
+        const char *eq = strchr(argv[i], '=');
+
+        if (eq == NULL) {
+            if (positional == NULL || positional[next_positional] == NULL) {
+                fprintf(stderr, "Unexpected argument '%s'\n", argv[i]);
+                return -1;
+            }
+            if (problem_set(cfg, positional[next_positional++], argv[i]) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        size_t len = (size_t)(eq - argv[i]);
+        if (len == 0 || len >= sizeof(key)) {
+            fprintf(stderr, "Invalid argument '%s'\n", argv[i]);
+            return -1;
+        }
+        memcpy(key, argv[i], len);
+        key[len] = '\0';
+        if (problem_set(cfg, key, eq + 1) != 0) {
+            return -1;
+        }
+    }
+
+    if (cfg->K < 1 || cfg->M < 1) {
+        fprintf(stderr, "K and M must be positive\n");
+        return -1;
+    }
+    return 0;
+}
+
+static inline void problem_print(const TransportConfig *cfg) {
+    printf("Problem: a=%g T=%g X=%g K=%d M=%d phi=%s psi=%s f=%s scheme=%s\n",
+           cfg->a, cfg->t_max, cfg->x_max, cfg->K, cfg->M,
+           phi_names[cfg->phi], psi_names[cfg->psi], source_names[cfg->f], scheme_names[cfg->scheme]);
+}
+
+#endif
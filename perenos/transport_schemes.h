@@ -0,0 +1,353 @@
+#ifndef TRANSPORT_SCHEMES_H
+#define TRANSPORT_SCHEMES_H
+
+// Difference schemes for u_t + a * u_x = f on a distributed 1D grid.
+//
+// Every kernel works on a local layer with ghost cells and updates points
+// first .. last-1; the caller exchanges ghost cells beforehand and sets the
+// boundary points. c = a*tau/h is the Courant number.
+//
+//   cross           3 levels, explicit, 2nd order, |c| <= 1
+//   upwind          2 levels, explicit, 1st order, |c| <= 1
+//   lax_wendroff    2 levels, explicit, 2nd order, |c| <= 1
+//   crank_nicolson  2 levels, implicit, 2nd order, unconditionally stable;
+//                   one tridiagonal system per step, solved across ranks
+//                   with the partitioned Thomas algorithm below
+
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "transport_problem.h"
+
+typedef struct {
+    const char *name;
+    int levels;         // time levels the scheme needs
+    int implicit;
+    double cfl_limit;   // largest stable |c|, 0 if there is none
+} SchemeInfo;
+
+static const SchemeInfo scheme_info[SCHEME_COUNT] = {
+    {"cross",          3, 0, 1.0},
+    {"upwind",         2, 0, 1.0},
+    {"lax_wendroff",   2, 0, 1.0},
+    {"crank_nicolson", 2, 1, 0.0},
+};
+
+// u_next[i] += s * f(t, x_i); steady sources come from the table
+static inline void apply_source(const TransportConfig *cfg, double *u_next, const double *source,
+                                int first, int last, int global_offset, double s, double t, double h) {
+    if (cfg->f == SOURCE_ZERO) {
+        return;
+    }
+    if (source != NULL) {
+        for (int i = first; i < last; i++) {
+            u_next[i] += s * source[i];
+        }
+    } else {
+        for (int i = first; i < last; i++) {
+            u_next[i] += s * problem_f(cfg, t, (global_offset + i) * h);
+        }
+    }
+}
+
+// Explicit central step:
+//     u_next = u_base - c * (u_diff[i+1] - u_diff[i-1]) + s * f(t, x_i)
+// The cross scheme uses c = a*tau/h, s = 2*tau; its start-up forward step
+// uses c = a*tau/(2h), s = tau. Zero and steady sources get their own loops,
+// so the common f = 0 case never evaluates the source.
+static inline void central_step(const TransportConfig *cfg, double *u_next, const double *u_base,
+                                const double *u_diff, const double *source, int first, int last,
+                                int global_offset, double c, double s, double t, double h) {
+    if (cfg->f == SOURCE_ZERO) {
+        for (int i = first; i < last; i++) {
+            u_next[i] = u_base[i] - c * (u_diff[i+1] - u_diff[i-1]);
+        }
+    } else if (source != NULL) {
+        for (int i = first; i < last; i++) {
+            u_next[i] = u_base[i] - c * (u_diff[i+1] - u_diff[i-1]) + s * source[i];
+        }
+    } else {
+        for (int i = first; i < last; i++) {
+            double x = (global_offset + i) * h;
+            u_next[i] = u_base[i] - c * (u_diff[i+1] - u_diff[i-1]) + s * problem_f(cfg, t, x);
+        }
+    }
+}
+
+// First-order upwind step, the difference is taken against the flow
+static inline void upwind_step(const TransportConfig *cfg, double *u_next, const double *u,
+                               const double *source, int first, int last, int global_offset,
+                               double c, double tau, double t, double h) {
+    if (c >= 0.0) {
+        for (int i = first; i < last; i++) {
+            u_next[i] = u[i] - c * (u[i] - u[i-1]);
+        }
+    } else {
+        for (int i = first; i < last; i++) {
+            u_next[i] = u[i] - c * (u[i+1] - u[i]);
+        }
+    }
+    apply_source(cfg, u_next, source, first, last, global_offset, tau, t, h);
+}
+
+// Lax-Wendroff step, source taken at the half step
+static inline void lax_wendroff_step(const TransportConfig *cfg, double *u_next, const double *u,
+                                     const double *source, int first, int last, int global_offset,
+                                     double c, double tau, double t, double h) {
+    double c1 = 0.5 * c;
+    double c2 = 0.5 * c * c;
+
+    for (int i = first; i < last; i++) {
+        u_next[i] = u[i] - c1 * (u[i+1] - u[i-1]) + c2 * (u[i+1] - 2.0 * u[i] + u[i-1]);
+    }
+    apply_source(cfg, u_next, source, first, last, global_offset, tau, t + 0.5 * tau, h);
+}
+
+// Partitioned Thomas algorithm for a tridiagonal system split by rows over
+// the ranks of 'comm'. Rank r owns n rows
+//     lower[i] x[i-1] + diag[i] x[i] + upper[i] x[i+1] = d[i]
+// where lower[0] and upper[n-1] couple to the neighbouring ranks. Locally
+//     x = y + x_left * v + x_right * w
+// with A_loc y = d, and v, w the responses to the two interface unknowns.
+// The first and last unknown of every rank form a reduced system of 2p
+// equations; its LU factors, v and w depend only on the matrix and are
+// computed once, so a solve costs one local Thomas sweep, one
+// MPI_Allgather of two doubles per rank and an O(p^2) reduced solve.
+typedef struct {
+    MPI_Comm comm;
+    int rank, size;
+    int n;
+    double *lower, *denom, *cp;  // local Thomas factors
+    double *v, *w;               // responses to the left / right interface
+    int nr;                      // 2 * size
+    double *reduced;             // LU of the reduced system (row-major)
+    int *pivot;
+    double *ends;                // gathered first / last values of y
+    double *z;                   // interface unknowns
+} ParallelTridiag;
+
+// Local sweep with the stored factors: A_loc x = d
+static inline void ptri_local_solve(const ParallelTridiag *pt, const double *d, double *x) {
+    int n = pt->n;
+
+    x[0] = d[0] / pt->denom[0];
+    for (int i = 1; i < n; i++) {
+        x[i] = (d[i] - pt->lower[i] * x[i-1]) / pt->denom[i];
+    }
+    for (int i = n - 2; i >= 0; i--) {
+        x[i] -= pt->cp[i] * x[i+1];
+    }
+}
+
+static inline void ptri_setup(ParallelTridiag *pt, int n, const double *lower, const double *diag,
+                              const double *upper, MPI_Comm comm) {
+    pt->comm = comm;
+    MPI_Comm_rank(comm, &pt->rank);
+    MPI_Comm_size(comm, &pt->size);
+    pt->n = n;
+    pt->nr = 2 * pt->size;
+
+    pt->lower = (double *)malloc(n * sizeof(double));
+    pt->denom = (double *)malloc(n * sizeof(double));
+    pt->cp = (double *)malloc(n * sizeof(double));
+    pt->v = (double *)malloc(n * sizeof(double));
+    pt->w = (double *)malloc(n * sizeof(double));
+
+    // Thomas factorization of the local block
+    for (int i = 0; i < n; i++) {
+        pt->lower[i] = lower[i];
+        pt->denom[i] = diag[i] - ((i > 0) ? lower[i] * pt->cp[i-1] : 0.0);
+        pt->cp[i] = upper[i] / pt->denom[i];
+    }
+
+    // Responses to the interface unknowns
+    double *e = (double *)calloc(n, sizeof(double));
+    e[0] = (pt->rank > 0) ? -lower[0] : 0.0;
+    ptri_local_solve(pt, e, pt->v);
+    e[0] = 0.0;
+    e[n-1] = (pt->rank < pt->size - 1) ? -upper[n-1] : 0.0;
+    ptri_local_solve(pt, e, pt->w);
+    free(e);
+
+    // Reduced system: unknowns z[2r] = first, z[2r+1] = last value of rank r
+    double mine[4] = {pt->v[0], pt->w[0], pt->v[n-1], pt->w[n-1]};
+    double *all = (double *)malloc(4 * pt->size * sizeof(double));
+    MPI_Allgather(mine, 4, MPI_DOUBLE, all, 4, MPI_DOUBLE, comm);
+
+    int nr = pt->nr;
+    pt->reduced = (double *)calloc((size_t)nr * nr, sizeof(double));
+    pt->pivot = (int *)malloc(nr * sizeof(int));
+    pt->ends = (double *)malloc(nr * sizeof(double));
+    pt->z = (double *)malloc(nr * sizeof(double));
+
+    for (int r = 0; r < pt->size; r++) {
+        for (int row = 2 * r; row <= 2 * r + 1; row++) {
+            double cv = (row == 2 * r) ? all[4*r] : all[4*r + 2];
+            double cw = (row == 2 * r) ? all[4*r + 1] : all[4*r + 3];
+
+            pt->reduced[row * nr + row] = 1.0;
+            if (r > 0) {
+                pt->reduced[row * nr + 2 * r - 1] -= cv;
+            }
+            if (r < pt->size - 1) {
+                pt->reduced[row * nr + 2 * r + 2] -= cw;
+            }
+        }
+    }
+    free(all);
+
+    // LU with partial pivoting, done once
+    double *R = pt->reduced;
+    for (int col = 0; col < nr; col++) {
+        int best = col;
+        for (int row = col + 1; row < nr; row++) {
+            if (fabs(R[row * nr + col]) > fabs(R[best * nr + col])) {
+                best = row;
+            }
+        }
+        pt->pivot[col] = best;
+        if (best != col) {
+            for (int j = 0; j < nr; j++) {
+                double tmp = R[col * nr + j];
+                R[col * nr + j] = R[best * nr + j];
+                R[best * nr + j] = tmp;
+            }
+        }
+        for (int row = col + 1; row < nr; row++) {
+            double factor = R[row * nr + col] / R[col * nr + col];
+            R[row * nr + col] = factor;
+            for (int j = col + 1; j < nr; j++) {
+                R[row * nr + j] -= factor * R[col * nr + j];
+            }
+        }
+    }
+}
+
+// Solve the distributed system for the right-hand side d, result in x
+static inline void ptri_solve(ParallelTridiag *pt, const double *d, double *x) {
+    int n = pt->n, nr = pt->nr;
+    double *R = pt->reduced;
+    double *z = pt->z;
+
+    ptri_local_solve(pt, d, x);
+
+    double mine[2] = {x[0], x[n-1]};
+    MPI_Allgather(mine, 2, MPI_DOUBLE, pt->ends, 2, MPI_DOUBLE, pt->comm);
+
+    for (int i = 0; i < nr; i++) {
+        z[i] = pt->ends[i];
+    }
+    for (int col = 0; col < nr; col++) {
+        if (pt->pivot[col] != col) {
+            double tmp = z[col];
+            z[col] = z[pt->pivot[col]];
+            z[pt->pivot[col]] = tmp;
+        }
+        for (int row = col + 1; row < nr; row++) {
+            z[row] -= R[row * nr + col] * z[col];
+        }
+    }
+    for (int row = nr - 1; row >= 0; row--) {
+        for (int j = row + 1; j < nr; j++) {
+            z[row] -= R[row * nr + j] * z[j];
+        }
+        z[row] /= R[row * nr + row];
+    }
+
+    double x_left = (pt->rank > 0) ? z[2 * pt->rank - 1] : 0.0;
+    double x_right = (pt->rank < pt->size - 1) ? z[2 * pt->rank + 2] : 0.0;
+    for (int i = 0; i < n; i++) {
+        x[i] += x_left * pt->v[i] + x_right * pt->w[i];
+    }
+}
+
+static inline void ptri_free(ParallelTridiag *pt) {
+    free(pt->lower);
+    free(pt->denom);
+    free(pt->cp);
+    free(pt->v);
+    free(pt->w);
+    free(pt->reduced);
+    free(pt->pivot);
+    free(pt->ends);
+    free(pt->z);
+}
+
+// Crank-Nicolson for the transport equation:
+//     u^{n+1}_m + c/4 (u^{n+1}_{m+1} - u^{n+1}_{m-1}) =
+//         u^n_m - c/4 (u^n_{m+1} - u^n_{m-1}) + tau/2 (f^n_m + f^{n+1}_m)
+// Row 0 holds the inflow value psi, row M the zero-gradient outflow
+// u_M = u_{M-1}. The local rows are the points this rank owns.
+typedef struct {
+    ParallelTridiag pt;
+    double *rhs;
+    double *sol;
+    double c4;     // c / 4
+} CrankNicolson;
+
+static inline void cn_setup(CrankNicolson *cn, double c, int local_start, int local_count, int M,
+                            MPI_Comm comm) {
+    double *lower = (double *)malloc(local_count * sizeof(double));
+    double *diag = (double *)malloc(local_count * sizeof(double));
+    double *upper = (double *)malloc(local_count * sizeof(double));
+
+    cn->c4 = 0.25 * c;
+    for (int i = 0; i < local_count; i++) {
+        int g = local_start + i;
+        diag[i] = 1.0;
+        if (g == 0) {
+            lower[i] = upper[i] = 0.0;
+        } else if (g == M) {
+            lower[i] = -1.0;
+            upper[i] = 0.0;
+        } else {
+            lower[i] = -cn->c4;
+            upper[i] = cn->c4;
+        }
+    }
+    ptri_setup(&cn->pt, local_count, lower, diag, upper, comm);
+
+    cn->rhs = (double *)malloc(local_count * sizeof(double));
+    cn->sol = (double *)malloc(local_count * sizeof(double));
+    free(lower);
+    free(diag);
+    free(upper);
+}
+
+// One step from u (with valid ghost cells) to u_next; owned points start at
+// index 'ghost_left' in both layers. psi_next is the inflow value at t+tau.
+static inline void cn_step(CrankNicolson *cn, const TransportConfig *cfg, double *u_next, const double *u,
+                           const double *source, int ghost_left, int local_start, int local_count,
+                           int M, double psi_next, double tau, double t, double h) {
+    for (int i = 0; i < local_count; i++) {
+        int g = local_start + i;
+        int j = ghost_left + i;
+
+        if (g == 0) {
+            cn->rhs[i] = psi_next;
+        } else if (g == M) {
+            cn->rhs[i] = 0.0;
+        } else {
+            cn->rhs[i] = u[j] - cn->c4 * (u[j+1] - u[j-1]);
+            if (cfg->f != SOURCE_ZERO) {
+                double x = g * h;
+                cn->rhs[i] += (source != NULL) ? tau * source[j] :
+                              0.5 * tau * (problem_f(cfg, t, x) + problem_f(cfg, t + tau, x));
+            }
+        }
+    }
+
+    ptri_solve(&cn->pt, cn->rhs, cn->sol);
+
+    for (int i = 0; i < local_count; i++) {
+        u_next[ghost_left + i] = cn->sol[i];
+    }
+}
+
+static inline void cn_free(CrankNicolson *cn) {
+    ptri_free(&cn->pt);
+    free(cn->rhs);
+    free(cn->sol);
+}
+
+#endif
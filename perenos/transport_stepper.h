@@ -0,0 +1,172 @@
+#ifndef TRANSPORT_STEPPER_H
+#define TRANSPORT_STEPPER_H
+
+// Time step control shared by the transport solvers.
+//
+// With cfl = 0 every step is the fixed tau = T/K. With cfl > 0 (explicit
+// schemes) the step is the largest stable one, cfl * h / max|a|. A new step
+// is planned against the largest speed over the next TAU_LOOKAHEAD steps
+// and kept while it stays stable and within TAU_GROWTH of the largest one,
+// so the step changes rarely; the time to the next output (snapshot or T)
+// is split into equal steps that hit it exactly.
+//
+// When a varies in time the wave speed is sampled on every rank and passed
+// through 'reduce_max' (MPI_Allreduce with MPI_MAX in the MPI solvers, NULL
+// in seq_test.c), so all ranks agree on tau. For a constant velocity it is
+// 'speed', computed once; solvers with several velocity components store
+// the sum of their magnitudes there.
+//
+// A three-level scheme has to be re-seeded when restart is set: with
+// ratio < 1 the layer t - tau lies between the two it keeps and can be
+// interpolated, otherwise (and at t = 0) it starts again with a two-level
+// step.
+
+#include <string.h>
+#include <math.h>
+#include "transport_problem.h"
+
+#define TAU_GROWTH 1.25
+#define TAU_LOOKAHEAD 16
+#define SPEED_SAMPLES 8
+
+typedef struct {
+    int adaptive;
+    double cfl, h, t_end;
+    int K, interval, outputs;   // fixed step: K steps, a snapshot every 'interval'
+    double speed;               // max |a| while it does not depend on t
+    double (*reduce_max)(double local);   // maximum over all ranks, NULL for one process
+
+    int k;                      // index of the current layer
+    double t;                   // its time
+    double tau;                 // step to the next layer
+    int restart;                // the step changed, the cross scheme has to be re-seeded
+    double ratio;               // new step / old step on a restart
+    int output;                 // snapshot number of the next layer, 0 if none
+
+    int next_output;            // equal steps from segment_start reach output next_output
+    double segment_start, segment_end;
+    int segment_steps, segment_done;
+    int restarts;
+    double tau_min, tau_max;
+} TimeStepper;
+
+// Number of equal steps no longer than 'limit' that cover 'span'
+static inline int stepper_equal_steps(double span, double limit) {
+    int n = isfinite(limit) ? (int)ceil(span / limit - 1e-9) : 1;
+    return (n < 1) ? 1 : n;
+}
+
+// Largest |a| between t0 and t1 on all ranks
+static inline double stepper_wave_speed(const TimeStepper *st, const TransportConfig *cfg,
+                                        double t0, double t1) {
+    double speed = 0.0;
+    for (int i = 0; i <= SPEED_SAMPLES; i++) {
+        speed = fmax(speed, fabs(problem_velocity(cfg, t0 + (t1 - t0) * i / SPEED_SAMPLES)));
+    }
+    return st->reduce_max ? st->reduce_max(speed) : speed;
+}
+
+// Largest stable step from t, 'guess' is the expected step length
+static inline double stepper_stable_tau(const TimeStepper *st, const TransportConfig *cfg, double t,
+                                        double guess) {
+    double speed = (cfg->a_amp == 0.0) ? st->speed : stepper_wave_speed(st, cfg, t, t + guess);
+    return (speed > 0.0) ? st->cfl * st->h / speed : INFINITY;
+}
+
+static inline void stepper_init(TimeStepper *st, const TransportConfig *cfg, double h, int num_snapshots,
+                                int adaptive, double (*reduce_max)(double)) {
+    memset(st, 0, sizeof(*st));
+    st->adaptive = adaptive;
+    st->cfl = cfg->cfl;
+    st->h = h;
+    st->t_end = cfg->t_max;
+    st->K = cfg->K;
+    st->outputs = num_snapshots;
+    st->interval = (cfg->K / num_snapshots < 1) ? 1 : cfg->K / num_snapshots;
+    st->speed = fabs(cfg->a);
+    st->reduce_max = reduce_max;
+    st->tau = cfg->t_max / cfg->K;
+    st->next_output = 1;
+    st->tau_min = INFINITY;
+}
+
+static inline int stepper_done(const TimeStepper *st) {
+    return st->adaptive ? st->t >= st->t_end : st->k >= st->K;
+}
+
+// Choose the step from the current layer
+static inline void stepper_next(TimeStepper *st, const TransportConfig *cfg) {
+    if (!st->adaptive) {
+        int k = st->k;
+        st->restart = (k == 0);
+        st->output = (k > 0 && k % st->interval == 0 && k / st->interval <= st->outputs) ? k / st->interval : 0;
+        return;
+    }
+
+    int keep = st->k > 0 && st->segment_done < st->segment_steps;
+    if (keep) {
+        double limit = stepper_stable_tau(st, cfg, st->t, st->tau);
+        keep = st->tau <= limit && st->tau * TAU_GROWTH >= limit;
+    }
+
+    if (keep) {
+        st->restart = 0;
+    } else {
+        // Equal stable steps up to the next output time
+        double end = (st->next_output >= st->outputs) ? st->t_end
+                                                      : st->next_output * st->t_end / st->outputs;
+        double limit = stepper_stable_tau(st, cfg, st->t, 0.0);
+        if (isfinite(limit)) {
+            limit = stepper_stable_tau(st, cfg, st->t, fmin(end - st->t, TAU_LOOKAHEAD * limit));
+        }
+        int n = stepper_equal_steps(end - st->t, limit);
+        double tau = (end - st->t) / n;
+
+        st->restart = (st->k == 0) || fabs(tau - st->tau) > 1e-9 * st->tau;
+        st->ratio = tau / st->tau;
+        if (st->restart && st->k > 0) {
+            st->restarts++;
+        }
+        st->tau = tau;
+        st->segment_start = st->t;
+        st->segment_end = end;
+        st->segment_steps = n;
+        st->segment_done = 0;
+    }
+
+    st->output = (st->segment_done + 1 == st->segment_steps) ? st->next_output : 0;
+    st->tau_min = fmin(st->tau_min, st->tau);
+    st->tau_max = fmax(st->tau_max, st->tau);
+}
+
+// Move to the next layer
+static inline void stepper_advance(TimeStepper *st) {
+    st->k++;
+    if (!st->adaptive) {
+        st->t = st->k * st->tau;
+        return;
+    }
+
+    st->segment_done++;
+    if (st->segment_done == st->segment_steps) {
+        st->t = st->segment_end;
+        st->next_output++;
+    } else {
+        st->t = st->segment_start + st->segment_done * st->tau;
+    }
+}
+
+// Number of steps for the solvers that divide [0, T] before they start
+// (parareal.c, mixed_precision.c) and need a constant velocity: with
+// cfl > 0 the fewest equal stable steps, otherwise K
+static inline int stepper_step_count(const TransportConfig *cfg, double h) {
+    if (cfg->cfl <= 0.0) {
+        return cfg->K;
+    }
+    TimeStepper st;
+    stepper_init(&st, cfg, h, 1, 1, NULL);
+    stepper_next(&st, cfg);
+    return st.segment_steps;
+}
+
+#endif
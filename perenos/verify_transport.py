@@ -0,0 +1,169 @@
+import argparse
+import csv
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# Verification of the transport solvers against the exact travelling-wave
+# solution (see problem_exact() in transport_problem.h).
+#
+# For every grid in a refinement series the sequential solver (seq_test.c)
+# and the MPI solver (parr_test_full.c) on each process count solve the same
+# problem at a fixed Courant number. The script reports L2 / Linf errors at
+# t = T, the observed convergence order, and the time-to-accuracy: the
+# fastest run of each configuration that reaches the target error.
+#
+# The run fails (exit code 1) when a solver crashes, produces NaN/Inf, or the
+# parallel error differs from the sequential one, which means the
+# decomposition changed the answer.
+#
+# Usage: python3 verify_transport.py [--sizes 100,200,400,800] [--procs 1,2,4]
+#                                    [key=value ...]
+# key=value pairs are passed to both solvers, e.g. f=sine_tx f_amp=1 a=0.5
+
+ERROR_LINE = re.compile(r'Error at t=\S+: L2=(\S+) Linf=(\S+)')
+TIME_LINE = re.compile(r'(?:Program|Total) execution time: (\S+) seconds')
+
+# X and T chosen so the default gaussian pulse stays away from x = X, where
+# the zero-gradient outflow condition is only first order accurate
+PROBLEM_DEFAULTS = ['X=2', 'T=0.5']
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+parser = argparse.ArgumentParser(description='Verify the transport solvers against the exact solution')
+parser.add_argument('--sizes', default='100,200,400,800', help='grid sizes M of the refinement series')
+parser.add_argument('--procs', default='1,2,4', help='process counts of the MPI solver')
+parser.add_argument('--courant', type=float, default=0.5, help='a*tau/h, K is derived from it')
+parser.add_argument('--target', type=float, default=5e-3, help='Linf error for time-to-accuracy')
+parser.add_argument('--rtol', type=float, default=1e-9, help='allowed relative parallel/sequential error mismatch')
+parser.add_argument('--mpirun', default='mpirun', help='MPI launcher')
+parser.add_argument('--no-build', action='store_true', help='use the existing seq_test and parr_test')
+parser.add_argument('--output', default='verification_results.csv')
+args, problem = parser.parse_known_args()
+
+problem = PROBLEM_DEFAULTS + problem
+settings = dict(p.split('=', 1) for p in problem if '=' in p)
+a = float(settings.get('a', settings.get('A', 1)))
+t_max = float(settings.get('T', 1))
+x_max = float(settings.get('X', 1))
+scheme = settings.get('scheme', 'cross')
+
+sizes = [int(m) for m in args.sizes.split(',')]
+procs = [int(p) for p in args.procs.split(',')]
+
+seq_bin = os.path.join(here, 'seq_test')
+par_bin = os.path.join(here, 'parr_test')
+
+if not args.no_build:
+    subprocess.run(['gcc', '-O2', 'seq_test.c', '-o', seq_bin, '-lm'], cwd=here, check=True)
+    subprocess.run(['mpicc', '-O2', 'parr_test_full.c', '-o', par_bin, '-lm'], cwd=here, check=True)
+
+# seq_test only implements the cross scheme, other schemes are checked
+# against the MPI solver on one process
+engines = []
+if scheme == 'cross':
+    engines.append(('seq', 1))
+engines += [('mpi', p) for p in procs]
+
+# The solvers write snapshots and append to benchmark_results.csv in the
+# current directory, so they run in a scratch directory
+workdir = tempfile.mkdtemp(prefix='verify_transport_')
+
+
+def run(engine, p, K, M):
+    if engine == 'seq':
+        cmd = [seq_bin, str(K), str(M)] + problem
+    else:
+        cmd = args.mpirun.split() + ['-np', str(p), par_bin, str(K), str(M)] + problem
+    proc = subprocess.run(cmd, cwd=workdir, capture_output=True, text=True)
+    out = proc.stdout
+    error = ERROR_LINE.search(out)
+    elapsed = TIME_LINE.search(out)
+    if proc.returncode != 0 or error is None or elapsed is None:
+        sys.stderr.write(out + proc.stderr)
+        return None
+    return float(error.group(1)), float(error.group(2)), float(elapsed.group(1))
+
+
+results = []
+failures = []
+
+for M in sizes:
+    K = max(1, math.ceil(abs(a) * t_max * M / (x_max * args.courant)))
+    reference = None
+    for engine, p in engines:
+        print(f'Running {engine} p={p} K={K} M={M}...', flush=True)
+        r = run(engine, p, K, M)
+        row = {'engine': engine, 'processes': p, 'K': K, 'M': M, 'status': 'ok'}
+        if r is None:
+            row['status'] = 'crashed'
+            failures.append(f'{engine} p={p} M={M}: no result')
+            results.append(row)
+            continue
+
+        l2, linf, elapsed = r
+        row.update(l2=l2, linf=linf, time=elapsed)
+        if not (math.isfinite(l2) and math.isfinite(linf)):
+            row['status'] = 'nan'
+            failures.append(f'{engine} p={p} M={M}: non-finite error')
+        elif reference is None:
+            reference = (l2, linf)
+        else:
+            for value, ref, name in ((l2, reference[0], 'L2'), (linf, reference[1], 'Linf')):
+                if abs(value - ref) > args.rtol * abs(ref) + 1e-15:
+                    row['status'] = 'diverged'
+                    failures.append(f'{engine} p={p} M={M}: {name} {value:.10e} != {ref:.10e}')
+        results.append(row)
+
+# Observed order between consecutive grids of the same configuration
+for engine, p in engines:
+    series = [r for r in results if r['engine'] == engine and r['processes'] == p and 'l2' in r]
+    for coarse, fine in zip(series, series[1:]):
+        ratio = math.log(fine['M'] / coarse['M'])
+        for norm in ('l2', 'linf'):
+            if coarse[norm] > 0 and fine[norm] > 0:
+                fine['order_' + norm] = math.log(coarse[norm] / fine[norm]) / ratio
+
+print(f'\nProblem: {" ".join(problem)}, scheme {scheme}, Courant {args.courant}')
+print(f'{"engine":>6} {"p":>3} {"K":>7} {"M":>7} {"time, s":>9} {"L2":>12} {"Linf":>12} '
+      f'{"ord L2":>7} {"ord Linf":>8}  status')
+for r in results:
+    if 'l2' not in r:
+        print(f'{r["engine"]:>6} {r["processes"]:>3} {r["K"]:>7} {r["M"]:>7} {"-":>9} {"-":>12} {"-":>12} '
+              f'{"-":>7} {"-":>8}  {r["status"]}')
+        continue
+    order_l2 = f'{r["order_l2"]:.2f}' if 'order_l2' in r else '-'
+    order_linf = f'{r["order_linf"]:.2f}' if 'order_linf' in r else '-'
+    print(f'{r["engine"]:>6} {r["processes"]:>3} {r["K"]:>7} {r["M"]:>7} {r["time"]:>9.4f} '
+          f'{r["l2"]:>12.4e} {r["linf"]:>12.4e} {order_l2:>7} {order_linf:>8}  {r["status"]}')
+
+# Time-to-accuracy: cheapest run of each configuration with Linf <= target
+print(f'\nTime to reach Linf <= {args.target:g}:')
+for engine, p in engines:
+    reached = [r for r in results if r['engine'] == engine and r['processes'] == p
+               and r.get('linf', math.inf) <= args.target]
+    if reached:
+        best = min(reached, key=lambda r: r['time'])
+        print(f'  {engine} p={p}: {best["time"]:.4f} s (M={best["M"]}, Linf={best["linf"]:.3e})')
+    else:
+        print(f'  {engine} p={p}: not reached')
+
+fields = ['engine', 'processes', 'K', 'M', 'time', 'l2', 'linf', 'order_l2', 'order_linf', 'status']
+with open(args.output, 'w', newline='') as fp:
+    writer = csv.DictWriter(fp, fieldnames=fields)
+    writer.writeheader()
+    for r in results:
+        writer.writerow({k: r.get(k, '') for k in fields})
+print(f'\nResults saved to {args.output}')
+shutil.rmtree(workdir, ignore_errors=True)
+
+if failures:
+    print('\nVERIFICATION FAILED:')
+    for f in failures:
+        print('  ' + f)
+    sys.exit(1)
+print('Verification passed')
@@ -1,184 +1,441 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <pthread.h>
-#include <sys/time.h>
+#include <stdatomic.h>
 
-// Функция, которую мы интегрируем
-// Изменить функцию можно здесь
-double f(double x) {
-    return sin(1/(x * x * x) );
-    // return sin(x) * exp(-0.1 * x * x);
-    // return sin(x / 3.1415)
-}
+#include "quadrature.h"
+#include "worker_pool.h"
 
-// Правило Симпсона для одного сегмента
-double simpson(double a, double b) {
-    double h = b - a;
-    return h / 6.0 * (f(a) + 4.0 * f((a + b) / 2.0) + f(b));
-}
+// Правило локального адаптивного метода: NULL - Симпсон, иначе
+// Гаусс-Кронрод
+const GKRule *gk_rule = NULL;
 
-// Адаптивное интегрирование на отрезке
-double adaptive_integrate(double a, double b, double tol, int *eval_count) {
-    double c = (a + b) / 2.0;
-    double whole = simpson(a, b);
-    double left = simpson(a, c);
-    double right = simpson(c, b);
-    double diff = fabs(left + right - whole);
-    
-    (*eval_count) += 5; // Учитываем вызовы функции f()
-    
-    if (diff <= 15.0 * tol) {
-        return left + right;
-    } else {
-        double tol_half = tol / 2.0;
-        return adaptive_integrate(a, c, tol_half, eval_count) + 
-               adaptive_integrate(c, b, tol_half, eval_count);
-    }
-}
-
-// Структура для хранения задач
+// Общая очередь задач: ограниченное кольцо MPMC без блокировок (схема
+// Вьюкова). У каждой ячейки свой счётчик sequence: ячейка свободна для
+// записи с номером pos, когда sequence == pos, и готова к чтению, когда
+// sequence == pos + 1. Потоки занимают номера через CAS на enqueue_pos /
+// dequeue_pos и больше не соревнуются за общий мьютекс
 typedef struct {
-    double a;        // Нижняя граница интегрирования
-    double b;        // Верхняя граница интегрирования
-    double tol;      // Допустимая погрешность
-    double result;   // Результат
-    int eval_count;  // Количество вызовов функции
-} Task;
+    atomic_long sequence;
+    Task task;
+} QueueCell;
 
-// Очередь задач
 typedef struct {
-    Task *tasks;           // Массив задач
-    int capacity;          // Вместимость очереди
-    int size;              // Текущий размер
-    int front;             // Указатель на начало очереди
-    int rear;              // Указатель на конец очереди
-    pthread_mutex_t mutex; // Мьютекс для синхронизации
-    pthread_cond_t not_empty; // Условная переменная для ожидания задач
-    pthread_cond_t not_full;  // Условная переменная для ожидания места
-    int finished;          // Флаг завершения работы
+    QueueCell *cells;
+    long mask;                                     // Вместимость - 1, вместимость - степень двойки
+    _Alignas(64) atomic_long enqueue_pos;          // Следующий номер для записи
+    _Alignas(64) atomic_long dequeue_pos;          // Следующий номер для чтения
 } TaskQueue;
 
+// Половина, не поместившаяся в дек владельца, уходит в общую очередь, а
+// если заполнена и она - владелец досчитывает её сам рекурсивно
+#define QUEUE_CAPACITY 4096       // Наименьшая вместимость общей очереди
+
+// Поток пула (worker_pool.h) и счётчик половин, не поместившихся в его дек
+typedef struct {
+    Worker base;
+    long tasks_spilled;    // Половин, ушедших в общую очередь из полного дека
+} QueueWorker;
+
 // Глобальные переменные
 TaskQueue task_queue;
-double global_result = 0.0;      // Общий результат
-int total_eval_count = 0;        // Общее количество вызовов функции
-pthread_mutex_t result_mutex;    // Мьютекс для обновления результата
+atomic_long pending_tasks;       // Созданные, но ещё не досчитанные задачи
 
-// Инициализация очереди задач
+// Инициализация очереди задач, вместимость округляется до степени двойки
 void init_queue(int capacity) {
-    task_queue.tasks = (Task*)malloc(capacity * sizeof(Task));
-    task_queue.capacity = capacity;
-    task_queue.size = 0;
-    task_queue.front = 0;
-    task_queue.rear = -1;
-    task_queue.finished = 0;
-    pthread_mutex_init(&task_queue.mutex, NULL);
-    pthread_cond_init(&task_queue.not_empty, NULL);
-    pthread_cond_init(&task_queue.not_full, NULL);
-    pthread_mutex_init(&result_mutex, NULL);
+    long size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    task_queue.cells = (QueueCell*)malloc(size * sizeof(QueueCell));
+    for (long i = 0; i < size; i++) {
+        atomic_init(&task_queue.cells[i].sequence, i);
+    }
+    task_queue.mask = size - 1;
+    atomic_init(&task_queue.enqueue_pos, 0);
+    atomic_init(&task_queue.dequeue_pos, 0);
 }
 
 // Освобождение ресурсов очереди
 void destroy_queue() {
-    free(task_queue.tasks);
-    pthread_mutex_destroy(&task_queue.mutex);
-    pthread_cond_destroy(&task_queue.not_empty);
-    pthread_cond_destroy(&task_queue.not_full);
-    pthread_mutex_destroy(&result_mutex);
+    free(task_queue.cells);
 }
 
-// Добавление задачи в очередь
-void enqueue(Task task) {
-    pthread_mutex_lock(&task_queue.mutex);
-    
-    // Ждем, пока очередь не освободится
-    while (task_queue.size == task_queue.capacity && !task_queue.finished) {
-        pthread_cond_wait(&task_queue.not_full, &task_queue.mutex);
-    }
+// Добавление задачи в очередь; 0, если очередь заполнена
+int enqueue(Task task) {
+    QueueCell *cell;
+    long pos = atomic_load_explicit(&task_queue.enqueue_pos, memory_order_relaxed);
     
-    // Проверяем, не завершена ли работа
-    if (task_queue.finished) {
-        pthread_mutex_unlock(&task_queue.mutex);
-        return;
+    while (1) {
+        cell = &task_queue.cells[pos & task_queue.mask];
+        long seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        long diff = seq - pos;
+        if (diff == 0) {
+            // Ячейка свободна - пробуем занять номер pos
+            if (atomic_compare_exchange_weak_explicit(&task_queue.enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0; // Кольцо заполнено
+        } else {
+            pos = atomic_load_explicit(&task_queue.enqueue_pos, memory_order_relaxed);
+        }
     }
     
-    // Добавляем задачу
-    task_queue.rear = (task_queue.rear + 1) % task_queue.capacity;
-    task_queue.tasks[task_queue.rear] = task;
-    task_queue.size++;
-    
-    // Сигнализируем о наличии задачи
-    pthread_cond_signal(&task_queue.not_empty);
-    pthread_mutex_unlock(&task_queue.mutex);
+    // Записываем задачу и публикуем ячейку для читателей
+    cell->task = task;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return 1;
 }
 
-// Извлечение задачи из очереди
+// Извлечение задачи из очереди; 0, если очередь пуста (не ждёт)
 int dequeue(Task *task) {
-    pthread_mutex_lock(&task_queue.mutex);
+    QueueCell *cell;
+    long pos = atomic_load_explicit(&task_queue.dequeue_pos, memory_order_relaxed);
     
-    // Ждем, пока в очереди появится задача
-    while (task_queue.size == 0 && !task_queue.finished) {
-        pthread_cond_wait(&task_queue.not_empty, &task_queue.mutex);
+    while (1) {
+        cell = &task_queue.cells[pos & task_queue.mask];
+        long seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        long diff = seq - (pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&task_queue.dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0; // Очередь пуста
+        } else {
+            pos = atomic_load_explicit(&task_queue.dequeue_pos, memory_order_relaxed);
+        }
     }
     
-    // Проверяем, не пуста ли очередь
-    if (task_queue.size == 0) {
-        pthread_mutex_unlock(&task_queue.mutex);
-        return 0; // Очередь пуста и работа завершена
+    // Забираем задачу и освобождаем ячейку для следующего круга
+    *task = cell->task;
+    atomic_store_explicit(&cell->sequence, pos + task_queue.mask + 1, memory_order_release);
+    return 1;
+}
+
+// Отдаёт половину отрезка другим потокам: в свой дек или, если он полон,
+// в общую очередь. 0 - места нет, половину надо досчитать самому
+int offer_half(void *ctx, Task half) {
+    QueueWorker *w = (QueueWorker*)ctx;
+    atomic_fetch_add(&pending_tasks, 1);
+    if (deque_push(&w->base.deque, half)) {
+        w->base.tasks_pushed++;
+        return 1;
     }
+    if (enqueue(half)) {
+        w->tasks_spilled++;
+        return 1;
+    }
+    atomic_fetch_sub(&pending_tasks, 1);
+    return 0;
+}
+
+// Деки пусты: задача из общей очереди (начальные и выплеснутые половины)
+int take_queued(Worker *w, Task *task) {
+    (void)w;
+    return dequeue(task);
+}
+
+// Поток завершается, когда не осталось ни одной недосчитанной задачи:
+// пока кто-то считает, в его деке могут появиться новые половины
+int queue_idle(Worker *w) {
+    (void)w;
+    return atomic_load(&pending_tasks) == 0;
+}
+
+void queue_task_done(Worker *w) {
+    (void)w;
+    atomic_fetch_sub(&pending_tasks, 1);
+}
+
+// ===== Глобально адаптивное интегрирование =====
+// Вместо рекурсии с делением допуска пополам хранится куча отрезков,
+// упорядоченная по оценке погрешности. На каждом раунде из кучи берутся k
+// худших отрезков, каждый делится пополам, потомки возвращаются в кучу.
+// Счёт останавливается, когда сумма оценок по всем отрезкам не больше tol:
+// гладкие участки не измельчаются сверх нужного, а глубина рекурсии не
+// ограничена стеком. Параллельная версия делит k отрезков раунда между
+// потоками, кучу обслуживает главный поток.
+// Отрезки оцениваются правилом G10K21 с оценкой погрешности QUADPACK,
+// как в qag (gauss_kronrod_qk). Оценка Симпсона |S2 - S1| / 15 на быстро
+// осциллирующей f (sin(1/x^3) у нуля) бывает мала случайно, и сумма таких
+// оценок останавливала счёт с ошибкой в сотни раз больше допуска
+#define GLOBAL_BATCH 16           // Отрезков на поток за раунд
+
+static const GKRule *const global_rule = &gk21;
+
+// Отрезок: интеграл по правилу Кронрода и оценка его погрешности
+typedef struct {
+    double a, b;
+    double value;
+    double err;
+} Interval;
+
+typedef struct {
+    Interval *items;
+    long size;
+    long capacity;
+} IntervalHeap;
+
+// Отрезок [a, b] и его оценка (2n - 1 вызовов f одним пакетом)
+void interval_init(Interval *it, double a, double b, int *eval_count) {
+    it->a = a;
+    it->b = b;
+    it->value = gauss_kronrod_qk(global_rule, a, b, &it->err, eval_count);
+    // Половины уже не различимы в double: дальше делить нельзя
+    if (gk_unsplittable(a, b)) {
+        it->err = 0.0;
+    }
+}
+
+// Деление count отрезков пополам
+void interval_split(const Interval *parents, int count, Interval *children, int *eval_count) {
+    for (int j = 0; j < count; j++) {
+        const Interval *it = &parents[j];
+        double c = (it->a + it->b) / 2.0;
+        interval_init(&children[2 * j], it->a, c, eval_count);
+        interval_init(&children[2 * j + 1], c, it->b, eval_count);
+    }
+}
+
+void heap_push(IntervalHeap *heap, const Interval *it) {
+    if (heap->size == heap->capacity) {
+        heap->capacity = heap->capacity ? 2 * heap->capacity : 1024;
+        heap->items = (Interval*)realloc(heap->items, heap->capacity * sizeof(Interval));
+    }
+    // Просеивание вверх
+    long i = heap->size++;
+    while (i > 0 && heap->items[(i - 1) / 2].err < it->err) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = *it;
+}
+
+// Извлекает отрезок с наибольшей оценкой погрешности
+Interval heap_pop(IntervalHeap *heap) {
+    Interval top = heap->items[0];
+    Interval last = heap->items[--heap->size];
     
-    // Извлекаем задачу
-    *task = task_queue.tasks[task_queue.front];
-    task_queue.front = (task_queue.front + 1) % task_queue.capacity;
-    task_queue.size--;
-    
-    // Сигнализируем о наличии места в очереди
-    pthread_cond_signal(&task_queue.not_full);
-    pthread_mutex_unlock(&task_queue.mutex);
-    
-    return 1; // Задача успешно извлечена
+    // Просеивание вниз
+    long i = 0;
+    while (1) {
+        long child = 2 * i + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if (child + 1 < heap->size && heap->items[child + 1].err > heap->items[child].err) {
+            child++;
+        }
+        if (heap->items[child].err <= last.err) {
+            break;
+        }
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->size > 0) {
+        heap->items[i] = last;
+    }
+    return top;
 }
 
-// Устанавливаем флаг завершения работы
-void finish_queue() {
-    pthread_mutex_lock(&task_queue.mutex);
-    task_queue.finished = 1;
-    pthread_cond_broadcast(&task_queue.not_empty); // Будим все потоки
-    pthread_cond_broadcast(&task_queue.not_full);  // Будим все потоки
-    pthread_mutex_unlock(&task_queue.mutex);
+// Общие данные раунда: главный поток кладёт в batch отрезки из кучи,
+// потоки между двумя барьерами делят их, потомки попадают в children
+typedef struct {
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    Interval *batch;
+    Interval *children;      // По два на отрезок из batch
+    int count;
+    int num_threads;
+    int stop;
+} GlobalRound;
+
+typedef struct {
+    _Alignas(CACHE_LINE) int eval_count;
+    int id;
+    GlobalRound *round;
+} GlobalWorker;
+
+// Своя доля раунда: непрерывный кусок batch
+static void global_share(GlobalWorker *gw) {
+    GlobalRound *r = gw->round;
+    int first = (int)((long)r->count * gw->id / r->num_threads);
+    int last = (int)((long)r->count * (gw->id + 1) / r->num_threads);
+    interval_split(&r->batch[first], last - first, &r->children[2 * first], &gw->eval_count);
 }
 
-// Функция для рабочего потока
-void* worker_thread(void *arg) {
-    Task task;
+void* global_worker_thread(void *arg) {
+    GlobalWorker *gw = (GlobalWorker*)arg;
+    
+    while (1) {
+        pthread_barrier_wait(&gw->round->start);
+        if (gw->round->stop) {
+            break;
+        }
+        global_share(gw);
+        pthread_barrier_wait(&gw->round->done);
+    }
+    return NULL;
+}
+
+typedef struct {
+    double result;
+    double error;          // Сумма оценок погрешности
+    int eval_count;
+    long intervals;        // Отрезков в куче в конце
+    long rounds;
+} GlobalStats;
+
+// Глобально адаптивное интегрирование: batch худших отрезков за раунд,
+// num_threads потоков (включая вызывающий); batch = 1 - классический
+// последовательный вариант
+GlobalStats global_integrate(double a, double b, double tol, int num_threads, int batch) {
+    GlobalStats stats = {0.0, 0.0, 0, 0, 0};
+    IntervalHeap heap = {NULL, 0, 0};
+    GlobalRound round;
+    GlobalWorker *gw = (GlobalWorker*)aligned_alloc(CACHE_LINE, num_threads * sizeof(GlobalWorker));
+    pthread_t *threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    
+    round.batch = (Interval*)malloc(batch * sizeof(Interval));
+    round.children = (Interval*)malloc(2 * batch * sizeof(Interval));
+    round.num_threads = num_threads;
+    round.stop = 0;
+    pthread_barrier_init(&round.start, NULL, num_threads);
+    pthread_barrier_init(&round.done, NULL, num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        gw[i].eval_count = 0;
+        gw[i].id = i;
+        gw[i].round = &round;
+        if (i > 0) {
+            pthread_create(&threads[i], NULL, global_worker_thread, &gw[i]);
+        }
+    }
     
-    while (dequeue(&task)) {
-        // Вычисляем интеграл для полученного участка
-        int task_eval_count = 0;
-        double task_result = adaptive_integrate(task.a, task.b, task.tol, &task_eval_count);
+    // Исходный отрезок
+    Interval root;
+    interval_init(&root, a, b, &gw[0].eval_count);
+    heap_push(&heap, &root);
+    KahanSum error = {0.0, 0.0};
+    kahan_add(&error, root.err);
+    
+    while (kahan_value(&error) > tol && heap.items[0].err > 0.0) {
+        // k худших отрезков; их погрешность заменят оценки потомков
+        round.count = 0;
+        while (round.count < batch && heap.size > 0 && heap.items[0].err > 0.0) {
+            round.batch[round.count] = heap_pop(&heap);
+            kahan_add(&error, -round.batch[round.count].err);
+            round.count++;
+        }
+        
+        pthread_barrier_wait(&round.start);
+        global_share(&gw[0]);
+        pthread_barrier_wait(&round.done);
         
-        // Обновляем глобальный результат
-        pthread_mutex_lock(&result_mutex);
-        global_result += task_result;
-        total_eval_count += task_eval_count;
-        pthread_mutex_unlock(&result_mutex);
+        for (int j = 0; j < 2 * round.count; j++) {
+            heap_push(&heap, &round.children[j]);
+            kahan_add(&error, round.children[j].err);
+        }
+        stats.rounds++;
     }
     
-    return NULL;
+    round.stop = 1;
+    pthread_barrier_wait(&round.start);
+    for (int i = 1; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    // Итог и погрешность заново по всем отрезкам кучи
+    KahanSum value = {0.0, 0.0};
+    KahanSum total_error = {0.0, 0.0};
+    for (long i = 0; i < heap.size; i++) {
+        kahan_add(&value, heap.items[i].value);
+        kahan_add(&total_error, heap.items[i].err);
+    }
+    stats.result = kahan_value(&value);
+    stats.error = kahan_value(&total_error);
+    stats.intervals = heap.size;
+    for (int i = 0; i < num_threads; i++) {
+        stats.eval_count += gw[i].eval_count;
+    }
+    
+    pthread_barrier_destroy(&round.start);
+    pthread_barrier_destroy(&round.done);
+    free(round.batch);
+    free(round.children);
+    free(heap.items);
+    free(threads);
+    free(gw);
+    return stats;
 }
 
-// Функция для получения текущего времени в секундах
-double get_time() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + tv.tv_usec / 1000000.0;
+// Режим global: параллельный и последовательный глобальный метод и
+// сравнение с локальными рекурсивными: Симпсоном и тем же правилом
+// Гаусса-Кронрода
+int run_global(double a, double b, double tol, int num_threads) {
+    double start_time = get_time();
+    GlobalStats par = global_integrate(a, b, tol, num_threads, num_threads * GLOBAL_BATCH);
+    double parallel_time = get_time() - start_time;
+    
+    start_time = get_time();
+    GlobalStats seq = global_integrate(a, b, tol, 1, 1);
+    double seq_time = get_time() - start_time;
+    
+    start_time = get_time();
+    int local_eval_count = 0;
+    KahanSum local_sum = {0.0, 0.0};
+    adaptive_integrate(a, b, tol, &local_sum, &local_eval_count);
+    double local_result = kahan_value(&local_sum);
+    double local_time = get_time() - start_time;
+    
+    start_time = get_time();
+    int local_gk_eval_count = 0;
+    KahanSum local_gk_sum = {0.0, 0.0};
+    gk_adaptive(global_rule, a, b, tol, &local_gk_sum, &local_gk_eval_count);
+    double local_gk_result = kahan_value(&local_gk_sum);
+    double local_gk_time = get_time() - start_time;
+    
+    printf("\n=== Результаты (глобальная адаптация, %s) ===\n", global_rule->name);
+    printf("Результат интегрирования (параллельный, %d отрезков за раунд): %.15g\n",
+           num_threads * GLOBAL_BATCH, par.result);
+    printf("Последовательный глобальный: %.15g\n", seq.result);
+    printf("Локальный рекурсивный: %.15g (Симпсон), %.15g (%s)\n",
+           local_result, local_gk_result, global_rule->name);
+    printf("Разница с последовательным глобальным: %g, с локальными: %g и %g\n",
+           fabs(par.result - seq.result), fabs(par.result - local_result), fabs(par.result - local_gk_result));
+    printf("Оценка погрешности: %g (параллельный), %g (последовательный)\n", par.error, seq.error);
+    
+    printf("\n=== Производительность ===\n");
+    printf("Время параллельного выполнения: %g сек.\n", parallel_time);
+    printf("Время последовательного глобального: %g сек.\n", seq_time);
+    printf("Время локального рекурсивного: %g сек. (Симпсон), %g сек. (%s)\n",
+           local_time, local_gk_time, global_rule->name);
+    printf("Ускорение: %g\n", seq_time / parallel_time);
+    
+    printf("\n=== Статистика ===\n");
+    printf("Вызовов функции: %d (параллельный), %d (последовательный), %d (локальный Симпсон), %d (локальный %s)\n",
+           par.eval_count, seq.eval_count, local_eval_count, local_gk_eval_count, global_rule->name);
+    printf("Отрезков: %ld (параллельный), %ld (последовательный), раундов: %ld и %ld\n",
+           par.intervals, seq.intervals, par.rounds, seq.rounds);
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
     // Проверка аргументов командной строки
-    if (argc < 5) {
-        printf("Использование: %s <нижняя_граница> <верхняя_граница> <допустимая_погрешность> <число_потоков>\n", argv[0]);
+    // Метод: local - рекурсивный Симпсон, global - куча отрезков,
+    // gk15 / gk21 - рекурсивный Гаусс-Кронрод
+    const char *method = (argc > 5) ? argv[5] : "local";
+    int rule = find_rule(method);
+    if (rule > 0) {
+        gk_rule = gk_rules[rule];
+    }
+    if (argc < 5 || (strcmp(method, "local") != 0 && strcmp(method, "global") != 0 && gk_rule == NULL)) {
+        printf("Использование: %s <нижняя_граница> <верхняя_граница> <допустимая_погрешность> <число_потоков> [local|global|gk15|gk21]\n", argv[0]);
         return 1;
     }
     
@@ -190,62 +447,82 @@ int main(int argc, char *argv[]) {
     printf("Численное интегрирование функции на интервале [%g, %g] с точностью %g\n", a, b, tol);
     printf("Количество потоков: %d\n", num_threads);
     
+    // Глобально адаптивный метод с кучей отрезков
+    if (strcmp(method, "global") == 0) {
+        return run_global(a, b, tol, num_threads > 0 ? num_threads : 1);
+    }
+    
     // Если потоков нет, выполняем последовательно
     if (num_threads <= 0) {
         double start_time = get_time();
         int seq_eval_count = 0;
-        double seq_result = adaptive_integrate(a, b, tol, &seq_eval_count);
+        KahanSum seq_sum = {0.0, 0.0};
+        integrate_interval(gk_rule, a, b, tol, &seq_sum, &seq_eval_count);
+        double seq_result = kahan_value(&seq_sum);
         double end_time = get_time();
         
         printf("\n=== Результаты ===\n");
         printf("Результат интегрирования: %g\n", seq_result);
         printf("Время выполнения: %g сек.\n", end_time - start_time);
         printf("Вызовов функции: %d\n", seq_eval_count);
+        if (gk_rule == NULL) {
+            printf("Делений отрезков: %ld (без повторного использования значений f было бы %ld вызовов)\n",
+                   subdivisions(seq_eval_count, 1), 5 * subdivisions(seq_eval_count, 1));
+        }
         
         return 0;
     }
     
     // Инициализация очереди задач
     int num_initial_tasks = num_threads * 4;
-    init_queue(num_initial_tasks * 2); // Вместимость в два раза больше для буферизации
+    init_queue(num_initial_tasks * 2 > QUEUE_CAPACITY ? num_initial_tasks * 2 : QUEUE_CAPACITY);
     
-    // Создаем начальные задачи
+    // Создаем начальные задачи вместе со значениями f на концах и в середине
     double segment_len = (b - a) / num_initial_tasks;
-    Task initial_task;
+    int setup_eval_count = 0;
     
     for (int i = 0; i < num_initial_tasks; i++) {
-        initial_task.a = a + i * segment_len;
-        initial_task.b = a + (i + 1) * segment_len;
-        initial_task.tol = tol / num_initial_tasks;
-        enqueue(initial_task);
+        enqueue(make_task(gk_rule, a + i * segment_len, a + (i + 1) * segment_len,
+                          tol / num_initial_tasks, &setup_eval_count));
     }
+    atomic_init(&pending_tasks, num_initial_tasks);
     
-    // Создаем потоки
-    pthread_t *threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
-    
-    // Запускаем таймер
-    double start_time = get_time();
-    
-    // Запускаем рабочие потоки
+    // Рабочие потоки с пустыми деками
+    QueueWorker *workers = (QueueWorker*)aligned_alloc(CACHE_LINE, num_threads * sizeof(QueueWorker));
+    Worker **pool_workers = (Worker**)malloc(num_threads * sizeof(Worker*));
+    WorkerPool pool = {pool_workers, num_threads, gk_rule, offer_half, take_queued, queue_idle,
+                       queue_task_done};
     for (int i = 0; i < num_threads; i++) {
-        pthread_create(&threads[i], NULL, worker_thread, NULL);
+        worker_init(&workers[i].base, &pool, i, 12345u + i);
+        workers[i].tasks_spilled = 0;
+        pool_workers[i] = &workers[i].base;
     }
     
-    // Ожидаем завершения работы потоков
-    finish_queue(); // Устанавливаем флаг завершения
+    // Запускаем таймер
+    double start_time = get_time();
     
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    // Потоки выходят сами, когда счётчик недосчитанных задач pending_tasks
+    // обнуляется, так что новые задачи можно добавлять в очередь в любой
+    // момент счёта
+    pool_run(&pool);
     
     // Завершаем измерение времени
     double end_time = get_time();
     double parallel_time = end_time - start_time;
     
+    // Складываем частичные суммы и счётчики потоков
+    KahanSum total = {0.0, 0.0};
+    pool_sum(&pool, &total);
+    double global_result = kahan_value(&total);
+    PoolStats stats = pool_stats(&pool);
+    int total_eval_count = setup_eval_count + stats.eval_count;
+    
     // Последовательное вычисление для сравнения
     start_time = get_time();
     int seq_eval_count = 0;
-    double seq_result = adaptive_integrate(a, b, tol, &seq_eval_count);
+    KahanSum seq_sum = {0.0, 0.0};
+    integrate_interval(gk_rule, a, b, tol, &seq_sum, &seq_eval_count);
+    double seq_result = kahan_value(&seq_sum);
     end_time = get_time();
     double seq_time = end_time - start_time;
     
@@ -254,6 +531,9 @@ int main(int argc, char *argv[]) {
     printf("Результат интегрирования (параллельный): %g\n", global_result);
     printf("Проверка (последовательный алгоритм): %g\n", seq_result);
     printf("Разница: %g\n", fabs(global_result - seq_result));
+    int split_eval_count = 0;
+    report_reproducibility("те же начальные отрезки", gk_rule, a, b, tol, num_initial_tasks,
+                           global_result, &split_eval_count);
     
     printf("\n=== Производительность ===\n");
     printf("Время параллельного выполнения: %g сек.\n", parallel_time);
@@ -264,10 +544,38 @@ int main(int argc, char *argv[]) {
     printf("\n=== Статистика ===\n");
     printf("Всего вызовов функции (параллельно): %d\n", total_eval_count);
     printf("Вызовов функции (последовательно): %d\n", seq_eval_count);
+    if (gk_rule == NULL) {
+        long seq_nodes = subdivisions(seq_eval_count, 1);
+        printf("Делений отрезков (последовательно): %ld, вызовов функции на деление: %.2f\n",
+               seq_nodes, (double)seq_eval_count / seq_nodes);
+        printf("Без повторного использования значений f было бы: %ld вызовов (в %.2f раза больше)\n",
+               5 * seq_nodes, 5.0 * seq_nodes / seq_eval_count);
+    } else {
+        // Тот же допуск методом Симпсона
+        int simpson_eval_count = 0;
+        KahanSum simpson_sum = {0.0, 0.0};
+        adaptive_integrate(a, b, tol, &simpson_sum, &simpson_eval_count);
+        printf("Правило %s: %d точек на отрезок; Симпсон с тем же допуском: %.15g, %d вызовов функции\n",
+               gk_rule->name, 2 * gk_rule->n - 1, kahan_value(&simpson_sum), simpson_eval_count);
+    }
+    
+    // Балансировка: время счёта каждого потока и кражи
+    printf("\n=== Балансировка нагрузки ===\n");
+    long total_spilled = 0;
+    for (int i = 0; i < num_threads; i++) {
+        Worker *w = &workers[i].base;
+        printf("Поток %d: задач %ld, выложено %ld, украдено %ld, вызовов функции %d, время счёта %g сек.\n",
+               i, w->tasks_done, w->tasks_pushed, w->steals, w->eval_count, w->busy_time);
+        total_spilled += workers[i].tasks_spilled;
+    }
+    report_imbalance(stats.max_busy, stats.sum_busy, num_threads);
+    printf("Кражи: %ld успешных, %ld неудачных обходов, выложено половин: %ld, в общую очередь: %ld\n",
+           stats.steals, stats.failed_steals, stats.tasks_pushed, total_spilled);
     
     // Освобождаем ресурсы
-    free(threads);
+    free(pool_workers);
+    free(workers);
     destroy_queue();
     
     return 0;
-}
\ No newline at end of file
+}
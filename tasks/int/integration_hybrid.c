@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <mpi.h>
+
+#include "quadrature.h"
+#include "worker_pool.h"
+
+// Гибридное интегрирование MPI + потоки. Работа балансируется на трёх
+// уровнях:
+//  - между процессами крупными отрезками: [a, b] делится на
+//    COARSE_PER_THREAD отрезков на каждый поток всех процессов, и потоки
+//    по одному забирают их номера из общего счётчика на процессе 0
+//    (MPI_Fetch_and_op), так что быстрый процесс просто берёт больше;
+//  - внутри процесса мелкими половинами: поток, как в integration.c,
+//    выкладывает правые половины в свой дек Чейза-Лева, а простаивающие
+//    потоки того же процесса их крадут;
+//  - между процессами кражей: когда крупные отрезки кончились, а в
+//    процессе работы нет, один из его потоков просит задачи у случайного
+//    процесса, как режим steal в integration_mpi.c. Запросы обслуживает
+//    любой поток процесса-жертвы, проверяя их между задачами и при
+//    выкладывании половин; вор получает половину задач из деков жертвы.
+// Сообщения между процессами нужны на крупный отрезок и на кражу, а мелкое
+// деление возле особенности расходится по потокам без MPI, пока в
+// процессе есть работа
+#define COARSE_PER_THREAD 4
+
+// Тэги кражи между процессами
+#define STEAL_TAG 1      // Запрос кражи
+#define WORK_TAG 2       // Ответ: массив задач, возможно пустой
+
+#define STEAL_MAX 64     // Больше задач за одну кражу не отдаётся
+#define POLL_INTERVAL 16 // Запросы кражи проверяются раз на столько выложенных половин
+
+// Общие счётчики в окне процесса 0
+#define COARSE_NEXT 0    // Номер следующего крупного отрезка
+#define BUSY_RANKS 1     // Процессов, у которых есть задачи, и пересылаемых краж
+
+// Поток пула (worker_pool.h) и его счётчики работы между процессами
+typedef struct {
+    Worker base;
+    long coarse_taken;     // Крупных отрезков взято из общего счётчика
+    long rank_steals;      // Успешных краж у других процессов
+    long tasks_received;   // Задач, полученных кражей у других процессов
+    long tasks_given;      // Задач, отданных другим процессам
+    long offers;           // Счётчик для проверки запросов кражи
+} RankWorker;
+
+// Статистика процесса для отчёта о балансировке
+typedef struct {
+    PoolStats threads;     // Сводка по потокам процесса
+    long coarse_taken;
+    long rank_steals;
+    long tasks_received;
+    long tasks_given;
+} RankStats;
+
+// Глобальные переменные
+const GKRule *gk_rule = NULL;    // Правило: NULL - Симпсон
+double lower, upper, tolerance;  // Интервал и допуск всего задания
+int num_coarse;                  // Число крупных отрезков на все процессы
+int mpi_rank, mpi_size;
+RankWorker *workers;             // Рабочие потоки процесса и их деки
+int num_workers;
+atomic_long pending_tasks;       // Задачи процесса: взятые, но не досчитанные
+atomic_int coarse_exhausted;     // Общий счётчик крупных отрезков исчерпан
+atomic_int rank_finished;        // Работы не осталось ни у одного процесса
+atomic_flag stealing = ATOMIC_FLAG_INIT; // Кражу у других процессов ведёт один поток
+MPI_Win counters_win;            // Общие счётчики на процессе 0
+pthread_mutex_t mpi_mutex = PTHREAD_MUTEX_INITIALIZER; // MPI_THREAD_SERIALIZED
+
+// Прибавляет delta к общему счётчику which на процессе 0 и возвращает
+// прежнее значение (delta == 0 - просто чтение). Вызывается под mpi_mutex
+long counter_add(int which, long delta) {
+    long old;
+    MPI_Fetch_and_op(&delta, &old, MPI_LONG, 0, which, (delta == 0) ? MPI_NO_OP : MPI_SUM,
+                     counters_win);
+    MPI_Win_flush(0, counters_win);
+    return old;
+}
+
+// Задачи процесса прибавляются и вычитаются этими функциями: переход
+// pending_tasks через ноль отмечается в счётчике BUSY_RANKS, так что
+// BUSY_RANKS == 0 означает, что задач нет ни у одного процесса
+void rank_tasks_add(long count) {
+    if (atomic_fetch_add(&pending_tasks, count) == 0) {
+        pthread_mutex_lock(&mpi_mutex);
+        counter_add(BUSY_RANKS, 1);
+        pthread_mutex_unlock(&mpi_mutex);
+    }
+}
+
+void rank_tasks_done(long count) {
+    if (atomic_fetch_sub(&pending_tasks, count) == count) {
+        pthread_mutex_lock(&mpi_mutex);
+        counter_add(BUSY_RANKS, -1);
+        pthread_mutex_unlock(&mpi_mutex);
+    }
+}
+
+// Отвечает на пришедшие запросы кражи (под mpi_mutex): вор получает
+// половину задач каждого дека процесса, начиная со старых - самых крупных.
+// За непустой ответ вор заранее учитывается в BUSY_RANKS, до того как
+// задачи уйдут из pending_tasks, поэтому счётчик не проходит через ноль,
+// пока задачи в пути
+void serve_steals(RankWorker *w) {
+    Task batch[STEAL_MAX];
+    int flag;
+    MPI_Status status;
+
+    MPI_Iprobe(MPI_ANY_SOURCE, STEAL_TAG, MPI_COMM_WORLD, &flag, &status);
+    while (flag) {
+        MPI_Recv(NULL, 0, MPI_BYTE, status.MPI_SOURCE, STEAL_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        int count = 0;
+        for (int i = 0; i < num_workers && count < STEAL_MAX; i++) {
+            Deque *d = &workers[i].base.deque;
+            long give = (atomic_load(&d->bottom) - atomic_load(&d->top)) / 2;
+            while (give > 0 && count < STEAL_MAX && deque_steal(d, &batch[count])) {
+                count++;
+                give--;
+            }
+        }
+        if (count > 0) {
+            counter_add(BUSY_RANKS, 1);
+            if (atomic_fetch_sub(&pending_tasks, count) == count) {
+                counter_add(BUSY_RANKS, -1);
+            }
+            w->tasks_given += count;
+        }
+        MPI_Send(batch, count * sizeof(Task), MPI_BYTE, status.MPI_SOURCE, WORK_TAG, MPI_COMM_WORLD);
+        MPI_Iprobe(MPI_ANY_SOURCE, STEAL_TAG, MPI_COMM_WORLD, &flag, &status);
+    }
+}
+
+// Проверяет запросы кражи, если MPI сейчас не занят другим потоком
+void poll_steals(RankWorker *w) {
+    if (mpi_size > 1 && pthread_mutex_trylock(&mpi_mutex) == 0) {
+        serve_steals(w);
+        pthread_mutex_unlock(&mpi_mutex);
+    }
+}
+
+// Отдаёт половину отрезка потокам своего процесса через свой дек; 0 - дек
+// полон, половину надо досчитать самому. Поток держит свою задачу, так
+// что pending_tasks здесь через ноль не проходит
+int offer_half(void *ctx, Task half) {
+    RankWorker *w = (RankWorker*)ctx;
+    if (++w->offers % POLL_INTERVAL == 0) {
+        poll_steals(w);
+    }
+    atomic_fetch_add(&pending_tasks, 1);
+    if (deque_push(&w->base.deque, half)) {
+        w->base.tasks_pushed++;
+        return 1;
+    }
+    atomic_fetch_sub(&pending_tasks, 1);
+    return 0;
+}
+
+// Берёт следующий крупный отрезок из общего счётчика. pending_tasks
+// увеличивается до обращения к счётчику: поток, увидевший исчерпанный
+// счётчик и pending_tasks == 0, знает, что взятых и не досчитанных
+// отрезков в процессе нет
+int take_coarse(Worker *base, Task *task) {
+    RankWorker *w = (RankWorker*)base;
+    if (atomic_load(&coarse_exhausted)) {
+        return 0;
+    }
+    rank_tasks_add(1);
+
+    pthread_mutex_lock(&mpi_mutex);
+    long index = counter_add(COARSE_NEXT, 1);
+    pthread_mutex_unlock(&mpi_mutex);
+
+    if (index >= num_coarse) {
+        atomic_store(&coarse_exhausted, 1);
+        rank_tasks_done(1);
+        return 0;
+    }
+    double segment_len = (upper - lower) / num_coarse;
+    *task = make_task(gk_rule, lower + index * segment_len, lower + (index + 1) * segment_len,
+                      tolerance / num_coarse, &base->eval_count);
+    w->coarse_taken++;
+    return 1;
+}
+
+// Крадёт задачи у случайного другого процесса и кладёт их в свой дек,
+// откуда их разберут и остальные потоки; возвращает число задач. Вызывается,
+// когда в процессе задач нет, поэтому чужие запросы, пришедшие за время
+// ожидания, получают пустые ответы
+int steal_from_rank(RankWorker *w) {
+    Task batch[STEAL_MAX];
+    int victim = rand_r(&w->base.seed) % (mpi_size - 1);
+    if (victim >= mpi_rank) {
+        victim++;
+    }
+
+    pthread_mutex_lock(&mpi_mutex);
+    MPI_Send(NULL, 0, MPI_BYTE, victim, STEAL_TAG, MPI_COMM_WORLD);
+    pthread_mutex_unlock(&mpi_mutex);
+
+    int flag = 0, bytes = 0;
+    MPI_Status status;
+    while (1) {
+        pthread_mutex_lock(&mpi_mutex);
+        MPI_Iprobe(victim, WORK_TAG, MPI_COMM_WORLD, &flag, &status);
+        if (flag) {
+            MPI_Get_count(&status, MPI_BYTE, &bytes);
+            MPI_Recv(batch, bytes, MPI_BYTE, victim, WORK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        } else {
+            serve_steals(w);
+        }
+        pthread_mutex_unlock(&mpi_mutex);
+        if (flag) {
+            break;
+        }
+        sched_yield();
+    }
+
+    int count = bytes / (int)sizeof(Task);
+    if (count == 0) {
+        return 0;
+    }
+    // Жертва уже учла процесс в BUSY_RANKS; если в нём тем временем
+    // появились задачи, этот учёт лишний
+    if (atomic_fetch_add(&pending_tasks, count) != 0) {
+        pthread_mutex_lock(&mpi_mutex);
+        counter_add(BUSY_RANKS, -1);
+        pthread_mutex_unlock(&mpi_mutex);
+    }
+    for (int i = 0; i < count; i++) {
+        deque_push(&w->base.deque, batch[i]);   // Свой дек пуст, места хватает
+    }
+    w->rank_steals++;
+    w->tasks_received += count;
+    return count;
+}
+
+// Работы в процессе нет: один поток крадёт у других процессов, пока
+// BUSY_RANKS не покажет, что работа кончилась везде
+void idle_rank(RankWorker *w) {
+    if (atomic_flag_test_and_set(&stealing)) {
+        return;    // Кражу уже ведёт другой поток
+    }
+    // Пока флаг у этого потока, задачи в процесс может принести только он
+    if (atomic_load(&pending_tasks) != 0) {
+        atomic_flag_clear(&stealing);
+        return;
+    }
+    pthread_mutex_lock(&mpi_mutex);
+    long busy = counter_add(BUSY_RANKS, 0);
+    pthread_mutex_unlock(&mpi_mutex);
+
+    if (busy == 0) {
+        atomic_store(&rank_finished, 1);
+    } else if (mpi_size > 1) {
+        steal_from_rank(w);
+    }
+    atomic_flag_clear(&stealing);
+}
+
+// Поток не нашёл задачу: если крупные отрезки кончились и в процессе
+// задач нет, крадёт у других процессов, иначе отвечает на их запросы.
+// Поток завершается, когда работы не осталось ни у одного процесса
+int rank_idle(Worker *base) {
+    RankWorker *w = (RankWorker*)base;
+    if (atomic_load(&rank_finished)) {
+        return 1;
+    }
+    if (atomic_load(&coarse_exhausted) && atomic_load(&pending_tasks) == 0) {
+        idle_rank(w);
+    } else {
+        poll_steals(w);
+    }
+    return atomic_load(&rank_finished);
+}
+
+void rank_task_done(Worker *w) {
+    (void)w;
+    rank_tasks_done(1);
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size, provided, rule = 0;
+    double params[3];
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    mpi_rank = rank;
+    mpi_size = size;
+
+    if (rank == 0) {
+        // Проверка аргументов командной строки
+        rule = (argc > 5) ? find_rule(argv[5]) : 0;
+        if (argc < 5 || rule < 0 || atoi(argv[4]) <= 0) {
+            printf("Использование: %s <нижняя_граница> <верхняя_граница> <допустимая_погрешность> <потоков_на_процесс> [simpson|gk15|gk21]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        if (provided < MPI_THREAD_SERIALIZED) {
+            printf("MPI не поддерживает вызовы из нескольких потоков (MPI_THREAD_SERIALIZED)\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        params[0] = atof(argv[1]);
+        params[1] = atof(argv[2]);
+        params[2] = atof(argv[3]);
+        num_workers = atoi(argv[4]);
+    }
+
+    // Рассылаем параметры всем процессам
+    MPI_Bcast(params, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&num_workers, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&rule, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    lower = params[0];
+    upper = params[1];
+    tolerance = params[2];
+    gk_rule = gk_rules[rule];
+    num_coarse = size * num_workers * COARSE_PER_THREAD;
+
+    if (rank == 0) {
+        printf("Численное интегрирование функции на интервале [%g, %g] с точностью %g\n",
+               lower, upper, tolerance);
+        printf("Процессов: %d, потоков на процесс: %d, крупных отрезков: %d\n",
+               size, num_workers, num_coarse);
+    }
+
+    // Счётчики крупных отрезков и занятых процессов
+    long *counters;
+    MPI_Win_allocate((rank == 0) ? 2 * sizeof(long) : 0, sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD,
+                     &counters, &counters_win);
+    if (rank == 0) {
+        counters[COARSE_NEXT] = 0;
+        counters[BUSY_RANKS] = 0;
+    }
+
+    // Инициализация потоков, их деков и частичных сумм
+    workers = (RankWorker*)aligned_alloc(CACHE_LINE, num_workers * sizeof(RankWorker));
+    Worker **pool_workers = (Worker**)malloc(num_workers * sizeof(Worker*));
+    WorkerPool pool = {pool_workers, num_workers, gk_rule, offer_half, take_coarse, rank_idle,
+                       rank_task_done};
+    for (int i = 0; i < num_workers; i++) {
+        RankWorker *w = &workers[i];
+        worker_init(&w->base, &pool, i, 12345u + 1000u * rank + i);
+        w->coarse_taken = w->rank_steals = w->tasks_received = w->tasks_given = w->offers = 0;
+        pool_workers[i] = &w->base;
+    }
+    atomic_init(&pending_tasks, 0);
+    atomic_init(&coarse_exhausted, 0);
+    atomic_init(&rank_finished, 0);
+
+    // Синхронизируем начало работы и запускаем таймер
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, counters_win);
+    double start_time = MPI_Wtime();
+
+    pool_run(&pool);
+
+    // Пока не все процессы закончили, отвечаем на запросы кражи пустыми
+    // ответами: вор входит в барьер только после ответа, так что запросов
+    // без ответа не остаётся
+    MPI_Request barrier;
+    int done = 0;
+    MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+    while (!done) {
+        serve_steals(&workers[0]);
+        MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Win_unlock_all(counters_win);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double parallel_time = MPI_Wtime() - start_time;
+
+    // Частичные суммы потоков и статистика процесса
+    KahanSum rank_sum = {0.0, 0.0};
+    pool_sum(&pool, &rank_sum);
+    RankStats stats = {pool_stats(&pool), 0, 0, 0, 0};
+    for (int i = 0; i < num_workers; i++) {
+        RankWorker *w = &workers[i];
+        stats.coarse_taken += w->coarse_taken;
+        stats.rank_steals += w->rank_steals;
+        stats.tasks_received += w->tasks_received;
+        stats.tasks_given += w->tasks_given;
+    }
+
+    // Суммы процессов складываются на процессе 0 в порядке номеров
+    KahanSum *rank_sums = NULL;
+    RankStats *all_stats = NULL;
+    if (rank == 0) {
+        rank_sums = (KahanSum*)malloc(size * sizeof(KahanSum));
+        all_stats = (RankStats*)malloc(size * sizeof(RankStats));
+    }
+    MPI_Gather(&rank_sum, sizeof(KahanSum), MPI_BYTE, rank_sums, sizeof(KahanSum), MPI_BYTE,
+               0, MPI_COMM_WORLD);
+    MPI_Gather(&stats, sizeof(RankStats), MPI_BYTE, all_stats, sizeof(RankStats), MPI_BYTE,
+               0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        KahanSum total = {0.0, 0.0};
+        long total_eval_count = 0;
+        for (int r = 0; r < size; r++) {
+            kahan_add(&total, rank_sums[r].sum);
+            kahan_add(&total, rank_sums[r].comp);
+            total_eval_count += all_stats[r].threads.eval_count;
+        }
+        double global_result = kahan_value(&total);
+
+        // Последовательное вычисление для сравнения
+        start_time = MPI_Wtime();
+        int seq_eval_count = 0;
+        KahanSum seq_sum = {0.0, 0.0};
+        integrate_interval(gk_rule, lower, upper, tolerance, &seq_sum, &seq_eval_count);
+        double seq_result = kahan_value(&seq_sum);
+        double seq_time = MPI_Wtime() - start_time;
+
+        // Выводим результаты
+        printf("\n=== Результаты ===\n");
+        printf("Результат интегрирования (параллельный): %g\n", global_result);
+        printf("Проверка (последовательный алгоритм): %g\n", seq_result);
+        printf("Разница: %g\n", fabs(global_result - seq_result));
+        int split_eval_count = 0;
+        report_reproducibility("те же крупные отрезки", gk_rule, lower, upper, tolerance, num_coarse,
+                               global_result, &split_eval_count);
+
+        printf("\n=== Производительность ===\n");
+        printf("Время параллельного выполнения: %g сек.\n", parallel_time);
+        printf("Время последовательного выполнения: %g сек.\n", seq_time);
+        printf("Ускорение: %g\n", seq_time / parallel_time);
+        printf("Эффективность: %g%%\n", (seq_time / parallel_time / (size * num_workers)) * 100);
+
+        printf("\n=== Статистика ===\n");
+        printf("Всего вызовов функции (параллельно): %ld\n", total_eval_count);
+        printf("Вызовов функции (те же крупные отрезки последовательно): %d\n", split_eval_count);
+
+        // Балансировка: крупные отрезки по процессам и кражи внутри них и между ними
+        printf("\n=== Балансировка нагрузки ===\n");
+        double max_busy = 0.0, sum_busy = 0.0;
+        for (int r = 0; r < size; r++) {
+            RankStats *s = &all_stats[r];
+            printf("Процесс %d: крупных отрезков %ld, задач %ld, краж между потоками %ld, краж у процессов %ld (получено задач %ld, отдано %ld), вызовов функции %d, время счёта потоков: макс %g, среднее %g сек.\n",
+                   r, s->coarse_taken, s->threads.tasks_done, s->threads.steals, s->rank_steals,
+                   s->tasks_received, s->tasks_given, s->threads.eval_count, s->threads.max_busy,
+                   s->threads.sum_busy / num_workers);
+            if (s->threads.max_busy > max_busy) max_busy = s->threads.max_busy;
+            sum_busy += s->threads.sum_busy;
+        }
+        report_imbalance(max_busy, sum_busy, size * num_workers);
+
+        free(rank_sums);
+        free(all_stats);
+    }
+
+    MPI_Win_free(&counters_win);
+    free(pool_workers);
+    free(workers);
+
+    MPI_Finalize();
+    return 0;
+}
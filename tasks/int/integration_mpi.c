@@ -1,227 +1,649 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <mpi.h>
 
-// Функция, которую мы интегрируем
-// Изменить функцию можно здесь
-double f(double x) {
-    return sin(x) * exp(-0.1 * x * x);
-    // return sin(x / 3.1415)
-}
+#include "../../trace/mpi_trace.h"
+#include "quadrature.h"
 
-// Правило Симпсона для одного сегмента
-double simpson(double a, double b) {
-    double h = b - a;
-    return h / 6.0 * (f(a) + 4.0 * f((a + b) / 2.0) + f(b));
-}
+// Правило, выбранное аргументом: NULL - Симпсон, иначе Гаусс-Кронрод
+const GKRule *gk_rule = NULL;
 
-// Адаптивное интегрирование на отрезке
-double adaptive_integrate(double a, double b, double tol, int *eval_count) {
-    double c = (a + b) / 2.0;
-    double whole = simpson(a, b);
-    double left = simpson(a, c);
-    double right = simpson(c, b);
-    double diff = fabs(left + right - whole);
-    
-    (*eval_count) += 5; // Учитываем вызовы функции f()
-    
-    if (diff <= 15.0 * tol) {
-        return left + right;
-    } else {
-        double tol_half = tol / 2.0;
-        return adaptive_integrate(a, c, tol_half, eval_count) + 
-               adaptive_integrate(c, b, tol_half, eval_count);
-    }
+// Адаптивное интегрирование выбранным правилом целиком на одном процессе
+double integrate_whole(const GKRule *rule, double a, double b, double tol, int *eval_count) {
+    KahanSum sum = {0.0, 0.0};
+    integrate_interval(rule, a, b, tol, &sum, eval_count);
+    return kahan_value(&sum);
 }
 
 // Тэги для MPI сообщений
-#define TASK_TAG 1
-#define RESULT_TAG 2
+#define TASK_TAG 1       // Пачка задач от мастера
+#define RESULT_TAG 2     // Пачка результатов вместе с возвращёнными половинами
 #define TERMINATE_TAG 3
+#define STEAL_TAG 4      // Запрос кражи (режим steal)
+#define WORK_TAG 5       // Ответ на запрос кражи: массив задач, возможно пустой
 
-// Структура задачи
-typedef struct {
-    double a;
-    double b;
-    double tol;
-} Task;
+// Окно предвыборки режима master по умолчанию: столько задач мастер держит
+// у каждого рабочего. Пока рабочий считает одну, следующие уже лежат у
+// него, и конвейер не простаивает на пересылке. Результаты рабочий
+// отправляет пачкой, досчитав половину окна, или когда его очередь
+// опустела. Окно 1 - прежний протокол: задача, результат, следующая задача
+#define PREFETCH_WINDOW 4
 
-// Структура результата
+// Глубина деления, после которой задача не досчитывается на месте: её
+// нерешённые половины возвращаются в пул, и трудный участок возле
+// особенности расходится по всем процессам, а не достаётся одному
+#define SPLIT_DEPTH 8
+#define MAX_SPLIT (2 << SPLIT_DEPTH)    // Больше половин одна задача не вернёт
+
+// Заголовок пачки результатов: сумма и число вызовов f по task_count
+// задачам; в том же сообщении следом идут split_count возвращённых половин
 typedef struct {
     double result;
     int eval_count;
+    int task_count;
+    int split_count;
 } Result;
 
+// Статистика процесса для отчёта о балансировке
+typedef struct {
+    long tasks_done;
+    long tasks_split;      // Половин, возвращённых в пул
+    long steals;           // Удачных краж
+    long tasks_stolen;     // Задач, полученных кражей
+    long failed_steals;    // Пустых ответов на запрос кражи
+    int eval_count;
+    double busy_time;
+    long result_messages;  // Пачек результатов, отправленных мастеру
+    double stall_time;     // Ожидание задач с пустой очередью (режим master)
+} RankStats;
+
+// Растущий массив задач: пул процесса и список возвращаемых половин
+typedef struct {
+    Task *tasks;
+    int count;
+    int capacity;
+} TaskList;
+
+// Место ещё под extra задач
+void task_list_reserve(TaskList *list, int extra) {
+    if (list->count + extra > list->capacity) {
+        while (list->count + extra > list->capacity) {
+            list->capacity = list->capacity ? 2 * list->capacity : 64;
+        }
+        list->tasks = (Task*)realloc(list->tasks, list->capacity * sizeof(Task));
+    }
+}
+
+void task_list_push(TaskList *list, Task task) {
+    task_list_reserve(list, 1);
+    list->tasks[list->count++] = task;
+}
+
+// Задачи берутся с конца (обход в глубину), а отдаются ворам из начала,
+// где лежат самые крупные отрезки
+Task task_list_pop(TaskList *list) {
+    return list->tasks[--list->count];
+}
+
+// Начальные отрезки с номерами [first, first + count) из n равных частей
+// [a, b]. Для Симпсона значения f на их концах и серединах считаются одним
+// пакетом, общие концы соседних отрезков - по одному разу
+void initial_tasks(double a, double b, double tol, int n, int first, int count,
+                   TaskList *list, int *eval_count) {
+    double segment_len = (b - a) / n;
+    double *x = (double*)malloc((2 * count + 1) * sizeof(double));
+    double *fx = (double*)calloc(2 * count + 1, sizeof(double));
+
+    for (int i = 0; i <= count; i++) {
+        x[2 * i] = a + (first + i) * segment_len;
+    }
+    for (int i = 0; i < count; i++) {
+        x[2 * i + 1] = (x[2 * i] + x[2 * i + 2]) / 2.0;
+    }
+    if (gk_rule == NULL) {
+        f_batch(x, fx, 2 * count + 1);
+        (*eval_count) += 2 * count + 1;
+    }
+    for (int i = 0; i < count; i++) {
+        double *p = fx + 2 * i;
+        Task task = {x[2 * i], x[2 * i + 2], tol / n, p[0], p[1], p[2],
+                     simpson(x[2 * i], x[2 * i + 2], p[0], p[1], p[2])};
+        task_list_push(list, task);
+    }
+    free(x);
+    free(fx);
+}
+
+// Половина, не сошедшаяся за SPLIT_DEPTH уровней, возвращается в пул
+int return_half(void *ctx, Task half) {
+    task_list_push((TaskList*)ctx, half);
+    return 1;
+}
+
+// Выполняет задачу на SPLIT_DEPTH уровней; что не сошлось - в split,
+// вклад остального - в acc
+void run_task(const Task *task, TaskList *split, KahanSum *acc, RankStats *stats) {
+    double start = MPI_Wtime();
+    int before = split->count;
+    trace_begin("compute");
+    bounded_task(gk_rule, *task, SPLIT_DEPTH, return_half, split, acc, &stats->eval_count);
+    trace_end();
+    stats->tasks_done++;
+    stats->tasks_split += split->count - before;
+    stats->busy_time += MPI_Wtime() - start;
+}
+
+// Задач в пачке результатов при окне window
+static inline int result_batch(int window) {
+    return (window / 2 > 0) ? window / 2 : 1;
+}
+
+// Статистика протокола на стороне мастера
+typedef struct {
+    long task_messages;    // Пачек задач
+    long tasks_sent;       // Задач в них
+    double latency;        // Сумма задержек "отправка задачи -> её результат"
+} MasterStats;
+
+// Мастер: держит у каждого рабочего до window задач, отправляя их пачками
+// через MPI_Isend, и ждёт через MPI_Waitany любое событие - пришедшую пачку
+// результатов или освободившийся буфер отправки. Возвращённые половины
+// сразу попадают в пул и раздаются тем, у кого в окне есть место
+double master_loop(double a, double b, double tol, int num_workers, int window,
+                   int *eval_count, MasterStats *ms) {
+    // Начальные подзадачи - больше, чем число рабочих
+    int num_initial_tasks = num_workers * 4;
+    TaskList pool = {NULL, 0, 0};
+    initial_tasks(a, b, tol, num_initial_tasks, 0, num_initial_tasks, &pool, eval_count);
+
+    // Буферы рабочих: отправляемая пачка, принимаемая пачка результатов и
+    // времена отправки задач, которые у рабочего в окне (он считает их по
+    // порядку, поэтому результаты приходят в том же порядке)
+    size_t recv_size = sizeof(Result) + (size_t)window * MAX_SPLIT * sizeof(Task);
+    Task *send_buf = (Task*)malloc((size_t)num_workers * window * sizeof(Task));
+    char *recv_buf = (char*)malloc(num_workers * recv_size);
+    double *sent_at = (double*)malloc((size_t)num_workers * window * sizeof(double));
+    int *sent_head = (int*)calloc(num_workers, sizeof(int));
+    int *outstanding = (int*)calloc(num_workers, sizeof(int));
+
+    // Запросы: [0, num_workers) - приём результатов рабочего i + 1,
+    // [num_workers, 2 * num_workers) - отправка ему задач
+    MPI_Request *requests = (MPI_Request*)malloc(2 * num_workers * sizeof(MPI_Request));
+    for (int i = 0; i < num_workers; i++) {
+        MPI_Irecv(recv_buf + i * recv_size, recv_size, MPI_BYTE, i + 1, RESULT_TAG, MPI_COMM_WORLD,
+                  &requests[i]);
+        requests[num_workers + i] = MPI_REQUEST_NULL;
+    }
+
+    int total_outstanding = 0;
+    KahanSum total = {0.0, 0.0};
+
+    while (1) {
+        // Дополняем окна рабочих, чей буфер отправки свободен
+        for (int i = 0; i < num_workers; i++) {
+            int count = window - outstanding[i];
+            if (count > pool.count) {
+                count = pool.count;
+            }
+            if (count == 0 || requests[num_workers + i] != MPI_REQUEST_NULL) {
+                continue;
+            }
+            Task *batch = send_buf + i * window;
+            double now = MPI_Wtime();
+            for (int j = 0; j < count; j++) {
+                batch[j] = task_list_pop(&pool);
+                sent_at[i * window + (sent_head[i] + outstanding[i] + j) % window] = now;
+            }
+            MPI_Isend(batch, count * sizeof(Task), MPI_BYTE, i + 1, TASK_TAG, MPI_COMM_WORLD,
+                      &requests[num_workers + i]);
+            outstanding[i] += count;
+            total_outstanding += count;
+            ms->task_messages++;
+            ms->tasks_sent += count;
+        }
+        if (total_outstanding == 0) {
+            break; // Пул пуст и никто не считает
+        }
+
+        int index;
+        MPI_Waitany(2 * num_workers, requests, &index, MPI_STATUS_IGNORE);
+        if (index >= num_workers) {
+            continue; // Отправка завершена, буфер рабочего свободен
+        }
+
+        // Пачка результатов рабочего index + 1 и его половины
+        int i = index;
+        char *message = recv_buf + i * recv_size;
+        Result result;
+        memcpy(&result, message, sizeof(Result));
+        double now = MPI_Wtime();
+        for (int j = 0; j < result.task_count; j++) {
+            ms->latency += now - sent_at[i * window + sent_head[i]];
+            sent_head[i] = (sent_head[i] + 1) % window;
+        }
+        outstanding[i] -= result.task_count;
+        total_outstanding -= result.task_count;
+        kahan_add(&total, result.result);
+        (*eval_count) += result.eval_count;
+
+        task_list_reserve(&pool, result.split_count);
+        memcpy(pool.tasks + pool.count, message + sizeof(Result), result.split_count * sizeof(Task));
+        pool.count += result.split_count;
+
+        MPI_Irecv(message, recv_size, MPI_BYTE, i + 1, RESULT_TAG, MPI_COMM_WORLD, &requests[i]);
+    }
+
+    // Больше результатов не будет: отменяем приём, дожидаемся отправок
+    for (int i = 0; i < num_workers; i++) {
+        MPI_Cancel(&requests[i]);
+        MPI_Wait(&requests[i], MPI_STATUS_IGNORE);
+    }
+    MPI_Waitall(num_workers, requests + num_workers, MPI_STATUSES_IGNORE);
+
+    // Отправляем сигнал завершения
+    for (int worker = 1; worker <= num_workers; worker++) {
+        MPI_Send(NULL, 0, MPI_BYTE, worker, TERMINATE_TAG, MPI_COMM_WORLD);
+    }
+
+    free(requests);
+    free(outstanding);
+    free(sent_head);
+    free(sent_at);
+    free(recv_buf);
+    free(send_buf);
+    free(pool.tasks);
+    return kahan_value(&total);
+}
+
+// Рабочий режима master: складывает присланные пачки в очередь, считает
+// задачи по порядку прихода и отправляет результаты пачками вместе с
+// недосчитанными половинами, не дожидаясь следующих задач
+void worker_loop(int master, int window, RankStats *stats) {
+    TaskList queue = {NULL, 0, 0}, split = {NULL, 0, 0};
+    int head = 0;                          // Следующая задача очереди
+    int batch = result_batch(window);
+    Result result = {0.0, 0, 0, 0};
+    char *message = NULL;
+    size_t message_size = 0;
+    KahanSum batch_sum = {0.0, 0.0};
+    MPI_Status status;
+    int flag;
+
+    while (1) {
+        // Забираем все пришедшие пачки задач; с пустой очередью ждём
+        while (1) {
+            if (head == queue.count) {
+                double wait_start = MPI_Wtime();
+                MPI_Probe(master, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+                stats->stall_time += MPI_Wtime() - wait_start;
+                flag = 1;
+            } else {
+                MPI_Iprobe(master, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+            }
+            if (!flag || status.MPI_TAG == TERMINATE_TAG) {
+                break;
+            }
+            int bytes;
+            MPI_Get_count(&status, MPI_BYTE, &bytes);
+            int count = bytes / (int)sizeof(Task);
+            task_list_reserve(&queue, count);
+            MPI_Recv(queue.tasks + queue.count, bytes, MPI_BYTE, master, TASK_TAG, MPI_COMM_WORLD,
+                     MPI_STATUS_IGNORE);
+            queue.count += count;
+        }
+
+        if (flag && status.MPI_TAG == TERMINATE_TAG) {
+            // Получаем сигнал завершения: мастер шлёт его, когда все
+            // результаты получены, так что очередь уже пуста
+            MPI_Recv(NULL, 0, MPI_BYTE, master, TERMINATE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            break;
+        }
+
+        // Вычисляем интеграл для очередного участка
+        Task task = queue.tasks[head++];
+        int before = stats->eval_count;
+        run_task(&task, &split, &batch_sum, stats);
+        result.eval_count += stats->eval_count - before;
+        result.task_count++;
+
+        // Пачка набрана или очередь опустела - отправляем результаты
+        if (result.task_count >= batch || head == queue.count) {
+            result.result = kahan_value(&batch_sum);
+            result.split_count = split.count;
+            size_t size = sizeof(Result) + split.count * sizeof(Task);
+            if (size > message_size) {
+                message = (char*)realloc(message, size);
+                message_size = size;
+            }
+            memcpy(message, &result, sizeof(Result));
+            memcpy(message + sizeof(Result), split.tasks, split.count * sizeof(Task));
+            MPI_Send(message, size, MPI_BYTE, master, RESULT_TAG, MPI_COMM_WORLD);
+
+            stats->result_messages++;
+            result = (Result){0.0, 0, 0, 0};
+            batch_sum = (KahanSum){0.0, 0.0};
+            split.count = 0;
+        }
+        if (head == queue.count) {
+            head = queue.count = 0;
+        }
+    }
+
+    free(message);
+    free(queue.tasks);
+    free(split.tasks);
+}
+
+// Прибавляет delta к счётчику незавершённых задач в окне процесса 0 и
+// возвращает новое значение (delta == 0 - просто чтение)
+long pending_add(MPI_Win pending, long delta) {
+    long old;
+    MPI_Fetch_and_op(&delta, &old, MPI_LONG, 0, 0, (delta == 0) ? MPI_NO_OP : MPI_SUM, pending);
+    MPI_Win_flush(0, pending);
+    return old + delta;
+}
+
+// Отвечает на все пришедшие запросы кражи: вор получает половину пула из
+// его начала, где лежат самые крупные отрезки, или пустой ответ
+void serve_steals(TaskList *pool) {
+    int flag;
+    MPI_Status status;
+
+    MPI_Iprobe(MPI_ANY_SOURCE, STEAL_TAG, MPI_COMM_WORLD, &flag, &status);
+    while (flag) {
+        MPI_Recv(NULL, 0, MPI_BYTE, status.MPI_SOURCE, STEAL_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        int give = pool->count / 2;
+        MPI_Send(pool->tasks, give * sizeof(Task), MPI_BYTE, status.MPI_SOURCE, WORK_TAG, MPI_COMM_WORLD);
+        memmove(pool->tasks, pool->tasks + give, (pool->count - give) * sizeof(Task));
+        pool->count -= give;
+        MPI_Iprobe(MPI_ANY_SOURCE, STEAL_TAG, MPI_COMM_WORLD, &flag, &status);
+    }
+}
+
+// Просит задачи у victim и ждёт ответа, отвечая тем временем на чужие
+// запросы (пустыми ответами - свой пул пуст); возвращает число задач
+int steal_from(int victim, TaskList *pool) {
+    int flag, bytes;
+    MPI_Status status;
+
+    MPI_Send(NULL, 0, MPI_BYTE, victim, STEAL_TAG, MPI_COMM_WORLD);
+    while (1) {
+        MPI_Iprobe(victim, WORK_TAG, MPI_COMM_WORLD, &flag, &status);
+        if (flag) {
+            break;
+        }
+        serve_steals(pool);
+    }
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    int count = bytes / (int)sizeof(Task);
+    task_list_reserve(pool, count);
+    MPI_Recv(pool->tasks + pool->count, bytes, MPI_BYTE, victim, WORK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    pool->count += count;
+    return count;
+}
+
+// Режим steal: мастера нет, все процессы, включая нулевой, считают свою
+// часть начальных отрезков и возвращённые половины кладут в свой пул.
+// Процесс с пустым пулом крадёт половину пула у случайного процесса.
+// Число незавершённых задач лежит в окне на процессе 0: задача вычитается
+// только после того, как её половины прибавлены, поэтому ноль означает,
+// что работы не осталось нигде, в том числе в пересылаемых кражах
+KahanSum steal_loop(double a, double b, double tol, int rank, int size, RankStats *stats) {
+    int tasks_per_rank = 4;
+    int num_initial_tasks = size * tasks_per_rank;
+    TaskList pool = {NULL, 0, 0}, split = {NULL, 0, 0};
+    initial_tasks(a, b, tol, num_initial_tasks, rank * tasks_per_rank, tasks_per_rank,
+                  &pool, &stats->eval_count);
+
+    long *pending_value;
+    MPI_Win pending;
+    MPI_Win_allocate((rank == 0) ? sizeof(long) : 0, sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD,
+                     &pending_value, &pending);
+    if (rank == 0) {
+        *pending_value = num_initial_tasks;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, pending);
+
+    unsigned int seed = 12345u + rank;
+    KahanSum local_sum = {0.0, 0.0};
+
+    while (1) {
+        serve_steals(&pool);
+        if (pool.count > 0) {
+            Task task = task_list_pop(&pool);
+            split.count = 0;
+            run_task(&task, &split, &local_sum, stats);
+            task_list_reserve(&pool, split.count);
+            memcpy(pool.tasks + pool.count, split.tasks, split.count * sizeof(Task));
+            pool.count += split.count;
+            pending_add(pending, split.count - 1);
+            continue;
+        }
+
+        // Свой пул пуст: либо работа кончилась везде, либо крадём
+        if (pending_add(pending, 0) == 0) {
+            break;
+        }
+        if (size > 1) {
+            int victim = rand_r(&seed) % (size - 1);
+            if (victim >= rank) {
+                victim++;
+            }
+            int stolen = steal_from(victim, &pool);
+            if (stolen > 0) {
+                stats->steals++;
+                stats->tasks_stolen += stolen;
+            } else {
+                stats->failed_steals++;
+            }
+        }
+    }
+
+    // Пока не все дошли до барьера, отвечаем на запросы кражи, отправленные
+    // до того, как их авторы узнали о конце работы: вор входит в барьер
+    // только после ответа, так что запросов без ответа не остаётся
+    MPI_Request barrier;
+    int done = 0;
+    MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+    while (!done) {
+        serve_steals(&pool);
+        MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Win_unlock_all(pending);
+    MPI_Win_free(&pending);
+    free(pool.tasks);
+    free(split.tasks);
+    return local_sum;
+}
+
 int main(int argc, char *argv[]) {
-    int rank, size, eval_count = 0, total_eval_count = 0;
-    double a, b, tol, local_result = 0.0, global_result = 0.0;
+    int rank, size, total_eval_count = 0, rule = 0, steal = 0, window = PREFETCH_WINDOW;
+    double a, b, tol, global_result = 0.0;
     double start_time, end_time, total_time;
-    
+    RankStats stats = {0};
+    MasterStats master_stats = {0, 0, 0.0};
+
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
-    
-    // Выделяем отдельный процесс как мастер
+
+    // По умолчанию выделяем отдельный процесс как мастер; в режиме steal
+    // мастера нет и считают все процессы
     int master = 0;
     int num_workers = size - 1;
-    
+
     if (rank == master) {
         // Проверка аргументов командной строки
-        if (argc < 4) {
-            printf("Использование: %s <нижняя_граница> <верхняя_граница> <допустимая_погрешность>\n", argv[0]);
+        rule = (argc > 4) ? find_rule(argv[4]) : 0;
+        steal = (argc > 5 && strcmp(argv[5], "steal") == 0);
+        window = (argc > 6) ? atoi(argv[6]) : PREFETCH_WINDOW;
+        if (argc < 4 || rule < 0 || (argc > 5 && !steal && strcmp(argv[5], "master") != 0) || window < 1) {
+            printf("Использование: %s <нижняя_граница> <верхняя_граница> <допустимая_погрешность> [simpson|gk15|gk21] [master|steal] [окно_предвыборки]\n", argv[0]);
             MPI_Abort(MPI_COMM_WORLD, 1);
             return 1;
         }
-        
+
         a = atof(argv[1]);
         b = atof(argv[2]);
         tol = atof(argv[3]);
-        
+        gk_rule = gk_rules[rule];
+
         printf("Численное интегрирование функции на интервале [%g, %g] с точностью %g\n", a, b, tol);
-        printf("Количество процессов: %d (1 мастер + %d рабочих)\n", size, num_workers);
-        
+        if (steal) {
+            printf("Количество процессов: %d (все считают, кража задач между процессами)\n", size);
+        } else {
+            printf("Количество процессов: %d (1 мастер + %d рабочих), окно предвыборки: %d\n",
+                   size, num_workers, window);
+        }
+
         // Если нет рабочих процессов, выполняем последовательно
-        if (num_workers == 0) {
+        if (num_workers == 0 && !steal) {
             start_time = MPI_Wtime();
-            global_result = adaptive_integrate(a, b, tol, &total_eval_count);
+            global_result = integrate_whole(gk_rule, a, b, tol, &total_eval_count);
             end_time = MPI_Wtime();
             total_time = end_time - start_time;
-            
+
             printf("\n=== Результаты ===\n");
             printf("Результат интегрирования: %g\n", global_result);
             printf("Время выполнения: %g сек.\n", total_time);
             printf("Вызовов функции: %d\n", total_eval_count);
-            
+
             MPI_Finalize();
             return 0;
         }
     }
-    
+
     // Рассылаем параметры всем процессам
     MPI_Bcast(&a, 1, MPI_DOUBLE, master, MPI_COMM_WORLD);
     MPI_Bcast(&b, 1, MPI_DOUBLE, master, MPI_COMM_WORLD);
     MPI_Bcast(&tol, 1, MPI_DOUBLE, master, MPI_COMM_WORLD);
-    
+    MPI_Bcast(&rule, 1, MPI_INT, master, MPI_COMM_WORLD);
+    MPI_Bcast(&steal, 1, MPI_INT, master, MPI_COMM_WORLD);
+    MPI_Bcast(&window, 1, MPI_INT, master, MPI_COMM_WORLD);
+    gk_rule = gk_rules[rule];
+    int num_computing = steal ? size : num_workers;
+
     // Синхронизируем начало работы и запускаем таймер
     MPI_Barrier(MPI_COMM_WORLD);
     start_time = MPI_Wtime();
-    
-    if (rank == master) {
-        // Мастер-процесс
-        
-        // Создаем начальные подзадачи - больше, чем число рабочих
-        int num_initial_tasks = num_workers * 4;
-        double segment_len = (b - a) / num_initial_tasks;
-        
-        // Очередь задач
-        Task *task_queue = (Task*)malloc(num_initial_tasks * sizeof(Task));
-        for (int i = 0; i < num_initial_tasks; i++) {
-            task_queue[i].a = a + i * segment_len;
-            task_queue[i].b = a + (i + 1) * segment_len;
-            task_queue[i].tol = tol / num_initial_tasks;
-        }
-        
-        int next_task = 0;
-        int tasks_completed = 0;
-        
-        // Отправляем первую задачу каждому рабочему
-        for (int worker = 1; worker <= num_workers && next_task < num_initial_tasks; worker++, next_task++) {
-            MPI_Send(&task_queue[next_task], sizeof(Task), MPI_BYTE, worker, TASK_TAG, MPI_COMM_WORLD);
-        }
-        
-        // Обрабатываем результаты и отправляем новые задачи
-        Result result;
-        MPI_Status status;
-        
-        while (tasks_completed < num_initial_tasks) {
-            // Получаем результат от любого рабочего
-            MPI_Recv(&result, sizeof(Result), MPI_BYTE, MPI_ANY_SOURCE, RESULT_TAG, MPI_COMM_WORLD, &status);
-            
-            // Обновляем общий результат
-            global_result += result.result;
-            total_eval_count += result.eval_count;
-            tasks_completed++;
-            
-            // Если есть еще задачи, отправляем следующую задачу
-            if (next_task < num_initial_tasks) {
-                MPI_Send(&task_queue[next_task], sizeof(Task), MPI_BYTE, status.MPI_SOURCE, TASK_TAG, MPI_COMM_WORLD);
-                next_task++;
-            } else {
-                // Отправляем сигнал завершения
-                MPI_Send(NULL, 0, MPI_BYTE, status.MPI_SOURCE, TERMINATE_TAG, MPI_COMM_WORLD);
-            }
+
+    if (steal) {
+        KahanSum rank_sum = steal_loop(a, b, tol, rank, size, &stats);
+
+        // Суммы процессов складываются на процессе 0 в порядке номеров
+        KahanSum *rank_sums = NULL;
+        if (rank == master) {
+            rank_sums = (KahanSum*)malloc(size * sizeof(KahanSum));
         }
-        
-        // Освобождаем память
-        free(task_queue);
-        
-    } else {
-        // Рабочие процессы
-        Task task;
-        Result result;
-        MPI_Status status;
-        
-        while (1) {
-            // Получаем задачу от мастера
-            MPI_Probe(master, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-            
-            if (status.MPI_TAG == TERMINATE_TAG) {
-                // Получаем сигнал завершения
-                MPI_Recv(NULL, 0, MPI_BYTE, master, TERMINATE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                break;
-            } else {
-                // Получаем задачу
-                MPI_Recv(&task, sizeof(Task), MPI_BYTE, master, TASK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                
-                // Вычисляем интеграл для полученного участка
-                int task_eval_count = 0;
-                double task_result = adaptive_integrate(task.a, task.b, task.tol, &task_eval_count);
-                
-                // Формируем и отправляем результат
-                result.result = task_result;
-                result.eval_count = task_eval_count;
-                MPI_Send(&result, sizeof(Result), MPI_BYTE, master, RESULT_TAG, MPI_COMM_WORLD);
-                
-                // Аккумулируем для статистики
-                local_result += task_result;
-                eval_count += task_eval_count;
+        MPI_Gather(&rank_sum, sizeof(KahanSum), MPI_BYTE, rank_sums, sizeof(KahanSum), MPI_BYTE,
+                   master, MPI_COMM_WORLD);
+        if (rank == master) {
+            KahanSum total = {0.0, 0.0};
+            for (int r = 0; r < size; r++) {
+                kahan_add(&total, rank_sums[r].sum);
+                kahan_add(&total, rank_sums[r].comp);
             }
+            global_result = kahan_value(&total);
+            free(rank_sums);
         }
+        MPI_Reduce(&stats.eval_count, &total_eval_count, 1, MPI_INT, MPI_SUM, master, MPI_COMM_WORLD);
+    } else if (rank == master) {
+        global_result = master_loop(a, b, tol, num_workers, window, &total_eval_count, &master_stats);
+    } else {
+        worker_loop(master, window, &stats);
     }
-    
+
     // Завершаем измерение времени
     MPI_Barrier(MPI_COMM_WORLD);
     end_time = MPI_Wtime();
     total_time = end_time - start_time;
-    
+
+    // Статистика всех процессов для отчёта о балансировке
+    RankStats *all_stats = NULL;
+    if (rank == master) {
+        all_stats = (RankStats*)malloc(size * sizeof(RankStats));
+    }
+    MPI_Gather(&stats, sizeof(RankStats), MPI_BYTE, all_stats, sizeof(RankStats), MPI_BYTE,
+               master, MPI_COMM_WORLD);
+
     // Дополнительно запускаем последовательное вычисление для сравнения на процессе 0
     double seq_result = 0.0, seq_time = 0.0;
     int seq_eval_count = 0;
-    
+
     if (rank == master) {
         start_time = MPI_Wtime();
-        seq_result = adaptive_integrate(a, b, tol, &seq_eval_count);
+        seq_result = integrate_whole(gk_rule, a, b, tol, &seq_eval_count);
         end_time = MPI_Wtime();
         seq_time = end_time - start_time;
-        
+
         // Выводим результаты
         printf("\n=== Результаты ===\n");
         printf("Результат интегрирования: %g\n", global_result);
         printf("Проверка (последовательный алгоритм): %g\n", seq_result);
         printf("Разница: %g\n", fabs(global_result - seq_result));
-        
+
         printf("\n=== Производительность ===\n");
         printf("Время параллельного выполнения: %g сек.\n", total_time);
         printf("Время последовательного выполнения: %g сек.\n", seq_time);
         printf("Ускорение: %g\n", seq_time / total_time);
-        printf("Эффективность: %g%%\n", (seq_time / total_time / num_workers) * 100);
-        
+        printf("Эффективность: %g%%\n", (seq_time / total_time / num_computing) * 100);
+
         printf("\n=== Статистика ===\n");
         printf("Всего вызовов функции: %d\n", total_eval_count);
         printf("Вызовов функции в последовательном алгоритме: %d\n", seq_eval_count);
+        if (gk_rule == NULL) {
+            printf("Делений отрезков: %ld (без повторного использования значений f было бы %ld вызовов)\n",
+                   subdivisions(seq_eval_count, 1), 5 * subdivisions(seq_eval_count, 1));
+        } else {
+            int simpson_eval_count = 0;
+            double simpson_result = integrate_whole(NULL, a, b, tol, &simpson_eval_count);
+            printf("Правило %s: %d точек на отрезок; Симпсон с тем же допуском: %.15g, %d вызовов функции\n",
+                   gk_rule->name, 2 * gk_rule->n - 1, simpson_result, simpson_eval_count);
+        }
+
+        // Балансировка: время счёта каждого процесса, деления и кражи
+        printf("\n=== Балансировка нагрузки ===\n");
+        double max_busy = 0.0, sum_busy = 0.0;
+        long total_split = 0, total_steals = 0, total_failed = 0, total_messages = 0;
+        double total_stall = 0.0;
+        for (int i = steal ? 0 : 1; i < size; i++) {
+            RankStats *s = &all_stats[i];
+            printf("Процесс %d: задач %ld, возвращено половин %ld, украдено задач %ld, вызовов функции %d, время счёта %g сек.\n",
+                   i, s->tasks_done, s->tasks_split, s->tasks_stolen, s->eval_count, s->busy_time);
+            if (s->busy_time > max_busy) max_busy = s->busy_time;
+            sum_busy += s->busy_time;
+            total_split += s->tasks_split;
+            total_steals += s->steals;
+            total_failed += s->failed_steals;
+            total_messages += s->result_messages;
+            total_stall += s->stall_time;
+        }
+        printf("Дисбаланс (макс/среднее время счёта): %g\n", max_busy / (sum_busy / num_computing));
+        printf("Возвращено половин в пул: %ld", total_split);
+        if (steal) {
+            printf(", кражи: %ld успешных, %ld пустых ответов", total_steals, total_failed);
+        }
+        printf("\n");
+
+        // Протокол мастера: пачки, задержка задачи и простой рабочих
+        if (!steal) {
+            printf("\n=== Протокол ===\n");
+            printf("Окно предвыборки: %d задач, результаты пачками до %d задач\n",
+                   window, result_batch(window));
+            printf("Сообщений с задачами: %ld на %ld задач, сообщений с результатами: %ld\n",
+                   master_stats.task_messages, master_stats.tasks_sent, total_messages);
+            printf("Задержка мастера (отправка задачи -> её результат): в среднем %g мс\n",
+                   master_stats.latency / master_stats.tasks_sent * 1000.0);
+            printf("Простой рабочих без задач: %g сек. суммарно, %g%% времени\n",
+                   total_stall, total_stall / (total_time * num_workers) * 100.0);
+        }
+        free(all_stats);
     }
-    
+
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
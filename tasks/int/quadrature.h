@@ -0,0 +1,448 @@
+#ifndef QUADRATURE_H
+#define QUADRATURE_H
+
+// Общее ядро квадратур для integration.c, integration_mpi.c и
+// integration_hybrid.c: интегрируемая функция, пакетные вызовы f,
+// адаптивный Симпсон с передачей значений f, правила Гаусса-Кронрода,
+// сумма Ноймайера и задача-отрезок с циклом отделения половин.
+// Функция f задаётся здесь одна на все программы. Сборка с -O2
+// -fopenmp-simd включает векторные sin/exp
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Векторные варианты sin и exp из libmvec (glibc >= 2.22, x86_64). С этими
+// объявлениями компилятор с -fopenmp-simd вызывает их в циклах под
+// #pragma omp simd: 2 точки за вызов с SSE2, 4 с -march=native (AVX2).
+// Без -fopenmp-simd прагмы игнорируются и всё считается скалярно
+// __GLIBC_PREREQ проверяется во вложенном #if: вне glibc (musl, macOS)
+// этого макроса нет, и его вызов в одном условии с defined() - ошибка
+// препроцессора, даже если defined(__GLIBC__) ложно
+#if defined(__x86_64__) && defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 22)
+double sin(double) __attribute__((simd("notinbranch")));
+double exp(double) __attribute__((simd("notinbranch")));
+#endif
+#endif
+
+// Функция, которую мы интегрируем
+// Изменить функцию можно здесь
+#pragma omp declare simd notinbranch
+static inline double f(double x) {
+    return sin(1/(x * x * x) );
+    // return sin(x) * exp(-0.1 * x * x);
+    // return sin(x / 3.1415)
+}
+
+// Значения f сразу в n точках: цикл векторизуется вместе с sin/exp
+static inline void f_batch(const double *restrict x, double *restrict y, int n) {
+    #pragma omp simd
+    for (int i = 0; i < n; i++) {
+        y[i] = f(x[i]);
+    }
+}
+
+// f на концах и в середине отрезка: {f(a), f((a + b) / 2), f(b)}
+static inline void f_ends(double a, double b, double *fx) {
+    double x[3] = {a, (a + b) / 2.0, b};
+    f_batch(x, fx, 3);
+}
+
+// f в серединах половин [a, c] и [c, b] - новые точки одного деления
+static inline void f_quarters(double a, double b, double *fx) {
+    double c = (a + b) / 2.0;
+    double x[2] = {(a + c) / 2.0, (c + b) / 2.0};
+    f_batch(x, fx, 2);
+}
+
+// Правило Симпсона для одного сегмента по уже вычисленным значениям f
+// на концах (fa, fb) и в середине (fm)
+static inline double simpson(double a, double b, double fa, double fm, double fb) {
+    double h = b - a;
+    return h / 6.0 * (fa + 4.0 * fm + fb);
+}
+
+// Сумма с компенсацией (алгоритм Ноймайера): в comp копятся младшие
+// разряды, потерянные при сложении, итог - sum + comp. Ошибка почти не
+// зависит от порядка слагаемых, поэтому параллельный результат отличается
+// от последовательного не больше чем в последних битах, как бы задачи ни
+// распределились по потокам.
+// Проверка воспроизводимости в драйверах считает те же начальные отрезки
+// последовательно: разбиение и слагаемые совпадают с параллельным счётом,
+// а порядок сложения нет (суммы потоков и процессов складываются
+// отдельно). Поэтому совпадение обычно точное, но гарантировано только до
+// последних битов
+typedef struct {
+    double sum;
+    double comp;
+} KahanSum;
+
+static inline void kahan_add(KahanSum *acc, double x) {
+    double t = acc->sum + x;
+    if (fabs(acc->sum) >= fabs(x)) {
+        acc->comp += (acc->sum - t) + x;
+    } else {
+        acc->comp += (x - t) + acc->sum;
+    }
+    acc->sum = t;
+}
+
+static inline double kahan_value(const KahanSum *acc) {
+    return acc->sum + acc->comp;
+}
+
+// Адаптивный шаг на отрезке [a, b]: fa, fm, fb - значения f на концах и в
+// середине, whole - правило Симпсона по ним. Значения передаются в
+// половины, так что на каждое деление вычисляются только две новые точки
+// (середины половин) вместо пяти. Вклад каждого принятого отрезка
+// добавляется в acc
+static inline void adaptive_step(double a, double b, double fa, double fm, double fb, double whole,
+                                 double tol, KahanSum *acc, int *eval_count) {
+    double c = (a + b) / 2.0;
+    double fq[2];
+    f_quarters(a, b, fq);
+    double fl = fq[0], fr = fq[1];
+    double left = simpson(a, c, fa, fl, fm);
+    double right = simpson(c, b, fm, fr, fb);
+    double diff = fabs(left + right - whole);
+    
+    (*eval_count) += 2; // Учитываем вызовы функции f()
+    
+    if (diff <= 15.0 * tol) {
+        kahan_add(acc, left + right);
+    } else {
+        double tol_half = tol / 2.0;
+        adaptive_step(a, c, fa, fl, fm, left, tol_half, acc, eval_count);
+        adaptive_step(c, b, fm, fr, fb, right, tol_half, acc, eval_count);
+    }
+}
+
+// Число делений отрезков адаптивным Симпсоном по числу вызовов f и числу
+// начальных отрезков: три вызова на начальный отрезок и два на деление
+static inline long subdivisions(long eval_count, long starts) {
+    return (eval_count - 3 * starts) / 2;
+}
+
+// Адаптивное интегрирование на отрезке: три начальных значения f и шаги
+static inline void adaptive_integrate(double a, double b, double tol, KahanSum *acc, int *eval_count) {
+    double fx[3];
+    f_ends(a, b, fx);
+    
+    (*eval_count) += 3;
+    adaptive_step(a, b, fx[0], fx[1], fx[2], simpson(a, b, fx[0], fx[1], fx[2]), tol, acc, eval_count);
+}
+
+// ===== Квадратуры Гаусса-Кронрода =====
+// Правило Кронрода на 2n+1 точках содержит все n узлов Гаусса, поэтому
+// оценка погрешности |K - G| не требует ни одного лишнего вызова f, а все
+// точки отрезка считаются одним пакетом f_batch. Узлы и веса - из QUADPACK
+// (qk15, qk21) для [-1, 1]; узлы Гаусса - xk[1], xk[3], ... (и центр,
+// если его номер нечётный), их веса - wg[j / 2]
+#define GK_MAX_POINTS 21
+
+typedef struct {
+    const char *name;
+    int n;               // Узлов xk: пары ±xk[j] и центр xk[n - 1] = 0
+    const double *xk;
+    const double *wk;    // Веса Кронрода
+    const double *wg;    // Веса Гаусса
+} GKRule;
+
+static const double xk15[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+static const double wk15[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+static const double wg7[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+static const double xk21[11] = {
+    0.995657163025808080735527280689003, 0.973906528517171720077964012084452,
+    0.930157491355708226001207180059508, 0.865063366688984510732096688423493,
+    0.780817726586416897063717578345042, 0.679409568299024406234327365114874,
+    0.562757134668604683339000099272694, 0.433395394129247190799265943165784,
+    0.294392862701460198131126603103866, 0.148874338981631210884826001129720,
+    0.000000000000000000000000000000000};
+static const double wk21[11] = {
+    0.011694638867371874278064396062192, 0.032558162307964727478818972459390,
+    0.054755896574351996031381300244580, 0.075039674810919952767043140916190,
+    0.093125454583697605535065465083366, 0.109387158802297641899210590325805,
+    0.123491976262065851077208980529191, 0.134709217311473325928054001771707,
+    0.142775938577060080797094273138717, 0.147739104901338491374841515972068,
+    0.149445554002916905664936468389821};
+static const double wg10[5] = {
+    0.066671344308688137593568809893332, 0.149451349150580593145776339657697,
+    0.219086362515982043995534934228163, 0.269266719309996355091226921569469,
+    0.295524224714752870173892994651146};
+
+static const GKRule gk15 = {"gk15", 8, xk15, wk15, wg7};
+static const GKRule gk21 = {"gk21", 11, xk21, wk21, wg10};
+
+// Значения f во всех 2n - 1 узлах правила на [a, b] одним пакетом:
+// fx[2j], fx[2j + 1] - в c -+ h * xk[j], fx[2n - 2] - в центре
+static inline void gk_nodes(const GKRule *rule, double a, double b, double *fx, int *eval_count) {
+    double c = (a + b) / 2.0;
+    double h = (b - a) / 2.0;
+    int m = rule->n - 1;
+    double x[GK_MAX_POINTS];
+    
+    for (int j = 0; j < m; j++) {
+        x[2 * j] = c - h * rule->xk[j];
+        x[2 * j + 1] = c + h * rule->xk[j];
+    }
+    x[2 * m] = c;
+    f_batch(x, fx, 2 * m + 1);
+    (*eval_count) += 2 * m + 1;
+}
+
+// Интеграл по правилу Кронрода на [a, b], в *err - оценка |K - G|
+static inline double gauss_kronrod(const GKRule *rule, double a, double b, double *err,
+                                   int *eval_count) {
+    double h = (b - a) / 2.0;
+    int m = rule->n - 1;
+    double fx[GK_MAX_POINTS] = {0.0};
+    gk_nodes(rule, a, b, fx, eval_count);
+    
+    double kronrod = rule->wk[m] * fx[2 * m];
+    double gauss = (m % 2 == 1) ? rule->wg[m / 2] * fx[2 * m] : 0.0;
+    for (int j = 0; j < m; j++) {
+        double pair = fx[2 * j] + fx[2 * j + 1];
+        kronrod += rule->wk[j] * pair;
+        if (j % 2 == 1) {
+            gauss += rule->wg[j / 2] * pair;
+        }
+    }
+    *err = fabs((kronrod - gauss) * h);
+    return kronrod * h;
+}
+
+// То же правило с оценкой погрешности qk15/qk21 из QUADPACK. |K - G|
+// сравнивается с resasc - интегралом |f - среднее| по весам Кронрода:
+// err = resasc * min(1, (200 |K - G| / resasc)^1.5), но не меньше
+// 50 eps * интеграла |f|. На отрезке, где f не разрешена (быстрые
+// осцилляции), |K - G| может оказаться малым случайно, а resasc остаётся
+// порядка самого отрезка, и оценка не занижается
+static inline double gauss_kronrod_qk(const GKRule *rule, double a, double b, double *err,
+                                      int *eval_count) {
+    double h = (b - a) / 2.0;
+    int m = rule->n - 1;
+    double fx[GK_MAX_POINTS] = {0.0};
+    gk_nodes(rule, a, b, fx, eval_count);
+    
+    double kronrod = rule->wk[m] * fx[2 * m];
+    double gauss = (m % 2 == 1) ? rule->wg[m / 2] * fx[2 * m] : 0.0;
+    double resabs = rule->wk[m] * fabs(fx[2 * m]);
+    for (int j = 0; j < m; j++) {
+        double pair = fx[2 * j] + fx[2 * j + 1];
+        kronrod += rule->wk[j] * pair;
+        resabs += rule->wk[j] * (fabs(fx[2 * j]) + fabs(fx[2 * j + 1]));
+        if (j % 2 == 1) {
+            gauss += rule->wg[j / 2] * pair;
+        }
+    }
+    double mean = kronrod / 2.0;
+    double resasc = rule->wk[m] * fabs(fx[2 * m] - mean);
+    for (int j = 0; j < m; j++) {
+        resasc += rule->wk[j] * (fabs(fx[2 * j] - mean) + fabs(fx[2 * j + 1] - mean));
+    }
+    resabs *= fabs(h);
+    resasc *= fabs(h);
+    
+    double e = fabs((kronrod - gauss) * h);
+    if (resasc != 0.0 && e != 0.0) {
+        e = resasc * fmin(1.0, pow(200.0 * e / resasc, 1.5));
+    }
+    if (resabs > DBL_MIN / (50.0 * DBL_EPSILON)) {
+        e = fmax(50.0 * DBL_EPSILON * resabs, e);
+    }
+    *err = e;
+    return kronrod * h;
+}
+
+// Отрезок больше нельзя делить: середина совпадает с концом в double
+static inline int gk_unsplittable(double a, double b) {
+    double c = (a + b) / 2.0;
+    return !(a < c && c < b);
+}
+
+// Адаптивное интегрирование правилом Гаусса-Кронрода с делением допуска
+// пополам, как у Симпсона
+static inline void gk_adaptive(const GKRule *rule, double a, double b, double tol,
+                               KahanSum *acc, int *eval_count) {
+    double err;
+    double value = gauss_kronrod(rule, a, b, &err, eval_count);
+    
+    if (err <= tol || gk_unsplittable(a, b)) {
+        kahan_add(acc, value);
+    } else {
+        double c = (a + b) / 2.0;
+        gk_adaptive(rule, a, c, tol / 2.0, acc, eval_count);
+        gk_adaptive(rule, c, b, tol / 2.0, acc, eval_count);
+    }
+}
+
+// Правила по именам аргумента командной строки: NULL - Симпсон
+static const char *rule_names[3] = {"simpson", "gk15", "gk21"};
+static const GKRule *gk_rules[3] = {NULL, &gk15, &gk21};
+
+// Номер правила по имени или -1
+static inline int find_rule(const char *name) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, rule_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Локальный адаптивный метод правилом rule (NULL - Симпсон)
+static inline void integrate_interval(const GKRule *rule, double a, double b, double tol,
+                                      KahanSum *acc, int *eval_count) {
+    if (rule != NULL) {
+        gk_adaptive(rule, a, b, tol, acc, eval_count);
+    } else {
+        adaptive_integrate(a, b, tol, acc, eval_count);
+    }
+}
+
+typedef struct {
+    double a;        // Нижняя граница интегрирования
+    double b;        // Верхняя граница интегрирования
+    double tol;      // Допустимая погрешность
+    double fa;       // f(a)
+    double fm;       // f((a + b) / 2)
+    double fb;       // f(b)
+    double whole;    // Правило Симпсона на всём отрезке
+} Task;
+
+// Задача на отрезке [a, b]: для Симпсона значения f на концах и в середине
+// считаются сразу (3 вызова), Гауссу-Кронроду они не нужны
+static inline Task make_task(const GKRule *rule, double a, double b, double tol, int *eval_count) {
+    Task task = {a, b, tol, 0.0, 0.0, 0.0, 0.0};
+    if (rule == NULL) {
+        double fx[3];
+        f_ends(a, b, fx);
+        (*eval_count) += 3;
+        task.fa = fx[0];
+        task.fm = fx[1];
+        task.fb = fx[2];
+        task.whole = simpson(a, b, fx[0], fx[1], fx[2]);
+    }
+    return task;
+}
+
+// Планировщик, которому отдаются правые половины: 0 - места нет,
+// половину надо досчитать самому
+typedef int (*OfferHalf)(void *ctx, Task half);
+
+// Считает задачу: пока отрезок не проходит проверку точности, правая
+// половина отдаётся планировщику (её может взять другой поток), а счёт
+// продолжается с левой. Разбиение и значения f те же, что у рекурсивных
+// adaptive_step и gk_adaptive, вклады принятых отрезков добавляются в acc
+static inline void split_task(const GKRule *rule, Task task, OfferHalf offer, void *ctx,
+                              KahanSum *acc, int *eval_count) {
+    double a = task.a, b = task.b, tol = task.tol;
+    double fa = task.fa, fm = task.fm, fb = task.fb, whole = task.whole;
+
+    while (1) {
+        double c = (a + b) / 2.0;
+
+        if (rule != NULL) {
+            double err;
+            double value = gauss_kronrod(rule, a, b, &err, eval_count);
+            if (err <= tol || gk_unsplittable(a, b)) {
+                kahan_add(acc, value);
+                break;
+            }
+            tol /= 2.0;
+            Task half = {c, b, tol, 0.0, 0.0, 0.0, 0.0};
+            if (!offer(ctx, half)) {
+                gk_adaptive(rule, c, b, tol, acc, eval_count);
+            }
+            b = c;
+            continue;
+        }
+
+        double fq[2];
+        f_quarters(a, b, fq);
+        double fl = fq[0], fr = fq[1];
+        double left = simpson(a, c, fa, fl, fm);
+        double right = simpson(c, b, fm, fr, fb);
+        double diff = fabs(left + right - whole);
+
+        (*eval_count) += 2;
+
+        if (diff <= 15.0 * tol) {
+            kahan_add(acc, left + right);
+            break;
+        }
+
+        tol /= 2.0;
+        Task half = {c, b, tol, fm, fr, fb, right};
+        if (!offer(ctx, half)) {
+            adaptive_step(c, b, fm, fr, fb, right, tol, acc, eval_count);
+        }
+        b = c;
+        fb = fm;
+        fm = fl;
+        whole = left;
+    }
+}
+
+// Считает задачу так же, как adaptive_step и gk_adaptive, но делит её не
+// глубже depth уровней: каждая половина, не сошедшаяся на последнем
+// уровне, отдаётся планировщику целиком (0 - досчитать её самому).
+// Вклады принятых отрезков добавляются в acc
+static inline void bounded_task(const GKRule *rule, Task task, int depth, OfferHalf offer, void *ctx,
+                                KahanSum *acc, int *eval_count) {
+    double a = task.a, b = task.b, tol = task.tol / 2.0;
+    double c = (a + b) / 2.0;
+    Task halves[2];
+
+    if (rule != NULL) {
+        double err;
+        double value = gauss_kronrod(rule, a, b, &err, eval_count);
+        if (err <= task.tol || gk_unsplittable(a, b)) {
+            kahan_add(acc, value);
+            return;
+        }
+        halves[0] = (Task){a, c, tol, 0.0, 0.0, 0.0, 0.0};
+        halves[1] = (Task){c, b, tol, 0.0, 0.0, 0.0, 0.0};
+    } else {
+        double fq[2];
+        f_quarters(a, b, fq);
+        double left = simpson(a, c, task.fa, fq[0], task.fm);
+        double right = simpson(c, b, task.fm, fq[1], task.fb);
+
+        (*eval_count) += 2;
+
+        if (fabs(left + right - task.whole) <= 15.0 * task.tol) {
+            kahan_add(acc, left + right);
+            return;
+        }
+        halves[0] = (Task){a, c, tol, task.fa, fq[0], task.fm, left};
+        halves[1] = (Task){c, b, tol, task.fm, fq[1], task.fb, right};
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (depth > 0) {
+            bounded_task(rule, halves[i], depth - 1, offer, ctx, acc, eval_count);
+        } else if (!offer(ctx, halves[i])) {
+            if (rule != NULL) {
+                gk_adaptive(rule, halves[i].a, halves[i].b, tol, acc, eval_count);
+            } else {
+                adaptive_step(halves[i].a, halves[i].b, halves[i].fa, halves[i].fm, halves[i].fb,
+                              halves[i].whole, tol, acc, eval_count);
+            }
+        }
+    }
+}
+
+#endif
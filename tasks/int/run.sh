@@ -1,2 +1,4 @@
-gcc -o integration integration.c -lm -pthread
+gcc -O2 -fopenmp-simd -o integration integration.c -lm -pthread
 ./integration 0.01 10 0.00001 4
+./integration 0.01 10 0.00001 4 global
+./integration 0.01 10 0.00001 4 gk21
@@ -0,0 +1,3 @@
+mpicc -O2 -fopenmp-simd -o integration_hybrid integration_hybrid.c -lm -pthread
+mpirun -np 2 ./integration_hybrid 0.01 10 0.00001 4
+mpirun -np 2 ./integration_hybrid 0.01 10 0.00001 4 gk21
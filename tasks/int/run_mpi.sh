@@ -1,2 +1,5 @@
-mpicc -o integration integration.c -lm
-mpirun -np 4 ./integration 0 10 0.00001
+mpicc -O2 -fopenmp-simd -o integration integration_mpi.c -lm
+mpirun -np 4 ./integration 0.01 10 0.00001
+mpirun -np 4 ./integration 0.01 10 0.00001 gk21
+mpirun -np 4 ./integration 0.01 10 0.00001 simpson steal
+mpirun -np 4 ./integration 0.01 10 0.00001 simpson master 1
@@ -0,0 +1,73 @@
+#ifndef WORK_DEQUE_H
+#define WORK_DEQUE_H
+
+// Дек Чейза-Лева (Chase-Lev) для кражи работы между потоками, общий для
+// integration.c и integration_hybrid.c: владелец кладёт и берёт задачи с
+// нижнего конца (bottom) без блокировок, остальные потоки крадут с
+// верхнего (top) через CAS. Ёмкость фиксирована; что делать с половиной,
+// не поместившейся в полный дек, решает программа
+
+#include <stdatomic.h>
+
+#include "quadrature.h"
+
+#define DEQUE_CAPACITY 4096       // Степень двойки
+#define CACHE_LINE 64
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_long top;     // Сторона воров
+    _Alignas(CACHE_LINE) atomic_long bottom;  // Сторона владельца
+    Task tasks[DEQUE_CAPACITY];
+} Deque;
+
+// Кладёт задачу в свой дек; 0, если дек полон
+static inline int deque_push(Deque *d, Task task) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_CAPACITY) {
+        return 0;
+    }
+    d->tasks[b & (DEQUE_CAPACITY - 1)] = task;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return 1;
+}
+
+// Берёт последнюю положенную задачу из своего дека; 0, если он пуст
+static inline int deque_pop(Deque *d, Task *task) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        // Дек пуст
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+    *task = d->tasks[b & (DEQUE_CAPACITY - 1)];
+    if (t == b) {
+        // Последняя задача: соревнуемся с ворами за top
+        int won = atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                          memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+    return 1;
+}
+
+// Крадёт самую старую (обычно самую крупную) задачу из чужого дека
+static inline int deque_steal(Deque *d, Task *task) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return 0;
+    }
+    *task = d->tasks[t & (DEQUE_CAPACITY - 1)];
+    return atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
+
+#endif
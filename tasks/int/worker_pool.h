@@ -0,0 +1,201 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+// Пул рабочих потоков с деками Чейза-Лева, общий для integration.c и
+// integration_hybrid.c: состояние потока с его частичной суммой, поиск
+// задачи (свой дек, кража у соседей, затем источник программы), цикл
+// потока с учётом времени счёта и общие строки отчёта. Программа задаёт,
+// куда отдаются половины, откуда брать задачи, когда деки пусты, и когда
+// потоку без работы пора завершаться
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+#include "quadrature.h"
+#include "work_deque.h"
+
+typedef struct Worker Worker;
+
+// Источник задач, когда свой и соседние деки пусты: 0 - задачи нет
+typedef int (*TakeTask)(Worker *w, Task *task);
+// Поток не нашёл задачу: 1 - работы больше не будет, поток завершается
+typedef int (*IdleWorker)(Worker *w);
+// Поток досчитал задачу
+typedef void (*TaskDone)(Worker *w);
+
+typedef struct {
+    Worker **workers;      // Потоки по номерам
+    int num_workers;
+    const GKRule *rule;    // NULL - Симпсон
+    OfferHalf offer;       // Куда отдаются половины, ctx - Worker
+    TakeTask take;
+    IdleWorker idle;
+    TaskDone done;
+} WorkerPool;
+
+// Состояние рабочего потока и его статистика. Программа встраивает его
+// первым полем в свою структуру, если ей нужны свои счётчики. Частичная
+// сумма лежит на отдельной кэш-линии: потоки пишут только в свою, без
+// мьютекса и ложного разделения; суммы складываются после join
+struct Worker {
+    Deque deque;
+    _Alignas(CACHE_LINE) KahanSum result;
+    WorkerPool *pool;
+    int id;
+    unsigned int seed;     // Для выбора случайной жертвы кражи
+    long tasks_done;       // Выполнено задач (начальных, своих и украденных)
+    long tasks_pushed;     // Половин отрезков, выложенных в дек
+    long steals;           // Успешных краж у соседних потоков
+    long failed_steals;    // Поисков, не давших задачи
+    int eval_count;        // Вызовов f в этом потоке
+    double busy_time;      // Время счёта задач
+};
+
+// Сводка по потокам пула для отчёта
+typedef struct {
+    long tasks_done;
+    long tasks_pushed;
+    long steals;
+    long failed_steals;
+    int eval_count;
+    double max_busy;       // Наибольшее время счёта потока
+    double sum_busy;       // Сумма по потокам
+} PoolStats;
+
+// Функция для получения текущего времени в секундах
+static inline double get_time(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static inline void worker_init(Worker *w, WorkerPool *pool, int id, unsigned int seed) {
+    atomic_init(&w->deque.top, 0);
+    atomic_init(&w->deque.bottom, 0);
+    w->result.sum = 0.0;
+    w->result.comp = 0.0;
+    w->pool = pool;
+    w->id = id;
+    w->seed = seed;
+    w->tasks_done = w->tasks_pushed = w->steals = w->failed_steals = 0;
+    w->eval_count = 0;
+    w->busy_time = 0.0;
+}
+
+// Ищет работу: свой дек, кража у случайных соседей, затем источник
+// программы (общая очередь, крупные отрезки)
+static inline int pool_find_task(Worker *w, Task *task) {
+    WorkerPool *pool = w->pool;
+    if (deque_pop(&w->deque, task)) {
+        return 1;
+    }
+    for (int attempt = 0; attempt < pool->num_workers; attempt++) {
+        int victim = rand_r(&w->seed) % pool->num_workers;
+        if (victim != w->id && deque_steal(&pool->workers[victim]->deque, task)) {
+            w->steals++;
+            return 1;
+        }
+    }
+    if (pool->take(w, task)) {
+        return 1;
+    }
+    w->failed_steals++;
+    return 0;
+}
+
+// Функция для рабочего потока: задачи считаются, пока idle не скажет, что
+// работы больше не будет. Время между первой найденной задачей и первым
+// неудачным поиском идёт в busy_time
+static inline void *pool_worker_thread(void *arg) {
+    Worker *w = (Worker*)arg;
+    WorkerPool *pool = w->pool;
+    Task task;
+    double busy_start = -1.0;    // Начало текущего периода счёта
+
+    while (1) {
+        if (!pool_find_task(w, &task)) {
+            if (busy_start >= 0.0) {
+                w->busy_time += get_time() - busy_start;
+                busy_start = -1.0;
+            }
+            if (pool->idle(w)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if (busy_start < 0.0) {
+            busy_start = get_time();
+        }
+
+        // Вычисляем интеграл для полученного участка
+        split_task(pool->rule, task, pool->offer, w, &w->result, &w->eval_count);
+        w->tasks_done++;
+        pool->done(w);
+    }
+    return NULL;
+}
+
+// Запускает потоки пула и ждёт, пока все они завершатся
+static inline void pool_run(WorkerPool *pool) {
+    pthread_t *threads = (pthread_t*)malloc(pool->num_workers * sizeof(pthread_t));
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_create(&threads[i], NULL, pool_worker_thread, pool->workers[i]);
+    }
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+// Добавляет частичные суммы потоков в acc в порядке номеров потоков
+static inline void pool_sum(const WorkerPool *pool, KahanSum *acc) {
+    for (int i = 0; i < pool->num_workers; i++) {
+        kahan_add(acc, pool->workers[i]->result.sum);
+        kahan_add(acc, pool->workers[i]->result.comp);
+    }
+}
+
+static inline PoolStats pool_stats(const WorkerPool *pool) {
+    PoolStats stats = {0, 0, 0, 0, 0, 0.0, 0.0};
+    for (int i = 0; i < pool->num_workers; i++) {
+        const Worker *w = pool->workers[i];
+        stats.tasks_done += w->tasks_done;
+        stats.tasks_pushed += w->tasks_pushed;
+        stats.steals += w->steals;
+        stats.failed_steals += w->failed_steals;
+        stats.eval_count += w->eval_count;
+        if (w->busy_time > stats.max_busy) stats.max_busy = w->busy_time;
+        stats.sum_busy += w->busy_time;
+    }
+    return stats;
+}
+
+// Проверка воспроизводимости: те же count начальных отрезков [a, b] с
+// допуском tol / count последовательно, в порядке номеров (что с чем
+// сравнивается, см. KahanSum в quadrature.h). what - как программа
+// называет эти отрезки
+static inline void report_reproducibility(const char *what, const GKRule *rule, double a, double b,
+                                          double tol, int count, double result, int *eval_count) {
+    KahanSum split_sum = {0.0, 0.0};
+    double segment_len = (b - a) / count;
+    for (int i = 0; i < count; i++) {
+        integrate_interval(rule, a + i * segment_len, a + (i + 1) * segment_len, tol / count,
+                           &split_sum, eval_count);
+    }
+    double split_result = kahan_value(&split_sum);
+    printf("Воспроизводимость (%s последовательно): %.17g и %.17g, разница %g\n",
+           what, result, split_result, fabs(result - split_result));
+}
+
+// Дисбаланс нагрузки: наибольшее время счёта потока к среднему по threads потокам
+static inline void report_imbalance(double max_busy, double sum_busy, int threads) {
+    printf("Дисбаланс (макс/среднее время счёта потока): %g\n", max_busy / (sum_busy / threads));
+}
+
+#endif
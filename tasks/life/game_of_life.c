@@ -1,8 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdbool.h>
 #include <time.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <mpi.h>
 #include <omp.h>
 
@@ -112,10 +113,178 @@ void computeNextGeneration(unsigned char *currentGrid, unsigned char *nextGrid,
     }
 }
 
-// Проверка, изменилась ли область за последнюю итерацию
-bool hasAreaChanged(unsigned char *oldGrid, unsigned char *newGrid, int width, int rowStart, int rowEnd) {
-    int size = (rowEnd - rowStart) * width;
-    return memcmp(oldGrid + rowStart * width, newGrid + rowStart * width, size) != 0;
+// Обмен строками-призраками на постоянных запросах (MPI_Send_init /
+// MPI_Recv_init). Соседи и размеры сообщений не меняются, поэтому запросы
+// создаются один раз для каждого из двух буферов поля (они меняются
+// местами каждый шаг) и на каждом шаге только перезапускаются.
+//
+// В режиме shared оба буфера всех процессов узла лежат в общем окне
+// MPI-3 (MPI_Win_allocate_shared), и строку соседа с того же узла процесс
+// копирует сам, без сообщений. Готовность поколения сосед сообщает
+// счетчиком в начале своего сегмента. Все процессы меняют буферы
+// одновременно, поэтому поколение g у всех лежит в буфере g % 2, а
+// перезаписать его сосед может только после того, как мы опубликуем
+// поколение g + 1, то есть уже прочитав его строку. Сообщения остаются
+// только для соседей на других узлах.
+#define HALO_HEADER 64  // байт перед буферами: счетчик в отдельной кэш-линии
+
+typedef struct {
+    unsigned char *grid[2];
+    MPI_Request requests[2][4];
+    int count;
+    
+    // Режим общей памяти; [0] - предыдущий процесс, [1] - следующий
+    int shared[2];
+    MPI_Comm node;
+    MPI_Win win;
+    atomic_long *ready;                 // последнее готовое поколение этого процесса
+    const unsigned char *peer[2];       // буферы соседа
+    atomic_long *peerReady[2];
+    int peerHeight[2];                  // localHeight соседа
+    int width;
+    int bufferSize;
+} Halo;
+
+// Находит сегмент соседа в окне узла, если сосед на этом узле
+static void haloAttachPeer(Halo *halo, int side, int neighbour) {
+    MPI_Group worldGroup, nodeGroup;
+    int nodeRank;
+    MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+    MPI_Comm_group(halo->node, &nodeGroup);
+    MPI_Group_translate_ranks(worldGroup, 1, &neighbour, nodeGroup, &nodeRank);
+    MPI_Group_free(&worldGroup);
+    MPI_Group_free(&nodeGroup);
+    
+    if (nodeRank == MPI_UNDEFINED) {
+        return;
+    }
+    
+    MPI_Aint bytes;
+    int dispUnit;
+    unsigned char *base;
+    MPI_Win_shared_query(halo->win, nodeRank, &bytes, &dispUnit, &base);
+    
+    halo->shared[side] = 1;
+    halo->peerReady[side] = (atomic_long *)base;
+    halo->peer[side] = base + HALO_HEADER;
+    halo->peerHeight[side] = (int)((bytes - HALO_HEADER) / (2 * halo->width)) - 2;
+}
+
+// Выделяет два буфера поля (с строками-призраками) и готовит обмен
+void haloInit(Halo *halo, int width, int localHeight, int rank, int prevRank, int nextRank, int shared) {
+    int bufferSize = width * (localHeight + 2);
+    
+    memset(halo, 0, sizeof(*halo));
+    halo->width = width;
+    halo->bufferSize = bufferSize;
+    halo->win = MPI_WIN_NULL;
+    halo->node = MPI_COMM_NULL;
+    
+    if (shared) {
+        unsigned char *base;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &halo->node);
+        MPI_Win_allocate_shared(HALO_HEADER + 2 * (MPI_Aint)bufferSize, 1, MPI_INFO_NULL, halo->node,
+                                &base, &halo->win);
+        halo->ready = (atomic_long *)base;
+        halo->grid[0] = base + HALO_HEADER;
+        halo->grid[1] = base + HALO_HEADER + bufferSize;
+        
+        // Пассивная эпоха на весь расчет: MPI_Win_sync упорядочивает
+        // обычные чтения и записи строк относительно счетчиков
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, halo->win);
+        atomic_store(halo->ready, -1);
+        MPI_Win_sync(halo->win);
+        MPI_Barrier(halo->node);
+        
+        haloAttachPeer(halo, 0, prevRank);
+        haloAttachPeer(halo, 1, nextRank);
+    } else {
+        halo->grid[0] = (unsigned char *)malloc(bufferSize * sizeof(unsigned char));
+        halo->grid[1] = (unsigned char *)malloc(bufferSize * sizeof(unsigned char));
+        if (!halo->grid[0] || !halo->grid[1]) {
+            fprintf(stderr, "Процесс %d: Ошибка выделения памяти для локального буфера\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    
+    for (int b = 0; b < 2; b++) {
+        unsigned char *grid = halo->grid[b];
+        MPI_Request *r = halo->requests[b];
+        int n = 0;
+        
+        // Верхняя строка уходит вверх (тег 0), нижняя - вниз (тег 1)
+        if (!halo->shared[0]) {
+            MPI_Send_init(grid + width, width, MPI_UNSIGNED_CHAR, prevRank, 0, MPI_COMM_WORLD, &r[n++]);
+            MPI_Recv_init(grid, width, MPI_UNSIGNED_CHAR, prevRank, 1, MPI_COMM_WORLD, &r[n++]);
+        }
+        if (!halo->shared[1]) {
+            MPI_Send_init(grid + localHeight * width, width, MPI_UNSIGNED_CHAR, nextRank, 1, MPI_COMM_WORLD,
+                          &r[n++]);
+            MPI_Recv_init(grid + (localHeight + 1) * width, width, MPI_UNSIGNED_CHAR, nextRank, 0,
+                          MPI_COMM_WORLD, &r[n++]);
+        }
+        halo->count = n;
+    }
+}
+
+// Сообщает соседям по узлу, что поколение generation посчитано
+void haloPublish(Halo *halo, long generation) {
+    if (halo->win != MPI_WIN_NULL) {
+        MPI_Win_sync(halo->win);
+        atomic_store_explicit(halo->ready, generation, memory_order_release);
+    }
+}
+
+// Копирует граничную строку поколения generation соседа с того же узла
+static void haloReadPeer(Halo *halo, int side, unsigned char *dest, int b, long generation) {
+    while (atomic_load_explicit(halo->peerReady[side], memory_order_acquire) < generation) {
+        sched_yield();  // сосед отстает не больше чем на шаг
+    }
+    MPI_Win_sync(halo->win);
+    
+    int width = halo->width;
+    int peerBuffer = width * (halo->peerHeight[side] + 2);
+    const unsigned char *grid = halo->peer[side] + b * peerBuffer;
+    
+    // У предыдущего процесса берем последнюю свою строку, у следующего - первую
+    const unsigned char *row = (side == 0) ? grid + halo->peerHeight[side] * width : grid + width;
+    memcpy(dest, row, width);
+}
+
+void haloExchange(Halo *halo, unsigned char *grid, long generation) {
+    int b = (grid == halo->grid[0]) ? 0 : 1;
+    MPI_Request *r = halo->requests[b];
+    int width = halo->width;
+    
+    MPI_Startall(halo->count, r);
+    
+    // Соседей по узлу читаем, пока идут сообщения
+    if (halo->shared[0]) {
+        haloReadPeer(halo, 0, grid, b, generation);
+    }
+    if (halo->shared[1]) {
+        haloReadPeer(halo, 1, grid + halo->bufferSize - width, b, generation);
+    }
+    
+    MPI_Waitall(halo->count, r, MPI_STATUSES_IGNORE);
+}
+
+void haloFree(Halo *halo) {
+    for (int b = 0; b < 2; b++) {
+        for (int i = 0; i < halo->count; i++) {
+            MPI_Request_free(&halo->requests[b][i]);
+        }
+    }
+    if (halo->win != MPI_WIN_NULL) {
+        // Никто из соседей не должен еще читать наши строки
+        MPI_Barrier(halo->node);
+        MPI_Win_unlock_all(halo->win);
+        MPI_Win_free(&halo->win);
+        MPI_Comm_free(&halo->node);
+    } else {
+        free(halo->grid[0]);
+        free(halo->grid[1]);
+    }
 }
 
 // Основная функция программы
@@ -123,6 +292,7 @@ int main(int argc, char *argv[]) {
     int rank, size, provided;
     int width, height, steps;
     int mode = PERFORMANCE_MODE;  // По умолчанию режим измерения производительности
+    int sharedHalo = 0;           // Обмен границами через общую память узла
     unsigned char *currentGrid = NULL, *nextGrid = NULL;
     unsigned char *localCurrentGrid = NULL, *localNextGrid = NULL;
     double startTime, endTime;
@@ -132,10 +302,12 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     
-    // Обработка аргументов командной строки
-    if (argc > 1) {
-        if (strcmp(argv[1], "demo") == 0) {
+    // Обработка аргументов командной строки: [demo] [shared]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "demo") == 0) {
             mode = DEMO_MODE;
+        } else if (strcmp(argv[i], "shared") == 0) {
+            sharedHalo = 1;
         }
     }
     
@@ -180,15 +352,17 @@ int main(int argc, char *argv[]) {
         localHeight++;
     }
     
-    // Выделение памяти для локальных буферов с учетом строк-призраков
-    int localBufferHeight = localHeight + 2;  // +2 для верхней и нижней граничных строк
-    localCurrentGrid = (unsigned char *)malloc(width * localBufferHeight * sizeof(unsigned char));
-    localNextGrid = (unsigned char *)malloc(width * localBufferHeight * sizeof(unsigned char));
+    // Определение соседних процессов с учетом тороидальной структуры
+    int prevRank = (rank - 1 + size) % size;
+    int nextRank = (rank + 1) % size;
     
-    if (!localCurrentGrid || !localNextGrid) {
-        fprintf(stderr, "Процесс %d: Ошибка выделения памяти для локального буфера\n", rank);
-        MPI_Abort(MPI_COMM_WORLD, 1);
-    }
+    // Локальные буферы с учетом строк-призраков (+2 для верхней и нижней
+    // граничных строк) и постоянные запросы для обмена ими
+    int localBufferHeight = localHeight + 2;
+    Halo halo;
+    haloInit(&halo, width, localHeight, rank, prevRank, nextRank, sharedHalo);
+    localCurrentGrid = halo.grid[0];
+    localNextGrid = halo.grid[1];
     
     // Вычисление начальных строк для каждого процесса
     int *sendcounts = NULL;
@@ -225,25 +399,15 @@ int main(int argc, char *argv[]) {
     }
     
     // Рассылка начальных данных всем процессам
-    MPI_Scatter(startRows, 1, MPI_INT, &startRows, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    int startRow = startRows;
+    int startRow;
+    MPI_Scatter(startRows, 1, MPI_INT, &startRow, 1, MPI_INT, 0, MPI_COMM_WORLD);
     
     // Рассылка слоев данных каждому процессу
     MPI_Scatterv(currentGrid, sendcounts, displs, MPI_UNSIGNED_CHAR,
                 localCurrentGrid + width, localHeight * width, MPI_UNSIGNED_CHAR,
                 0, MPI_COMM_WORLD);
     
-    // Определение соседних процессов с учетом тороидальной структуры
-    int prevRank = (rank - 1 + size) % size;
-    int nextRank = (rank + 1) % size;
-    
-    // Буферы для проверки изменений
-    bool *hasSendTopChanged = (bool *)calloc(steps, sizeof(bool));
-    bool *hasSendBottomChanged = (bool *)calloc(steps, sizeof(bool));
-    bool *hasLocalAreaChanged = (bool *)calloc(steps, sizeof(bool));
-    
-    // Установить начальное состояние первой итерации как "изменилось"
-    hasSendTopChanged[0] = hasSendBottomChanged[0] = hasLocalAreaChanged[0] = true;
+    haloPublish(&halo, 0);
     
     // Запуск таймера для измерения производительности
     MPI_Barrier(MPI_COMM_WORLD);
@@ -251,49 +415,15 @@ int main(int argc, char *argv[]) {
     
     // Основной цикл моделирования
     for (int step = 0; step < steps; step++) {
-        MPI_Request sendTopRequest, sendBottomRequest, recvTopRequest, recvBottomRequest;
-        
-        // Обмен верхней и нижней границами с соседними процессами (если произошли изменения)
-        if (step == 0 || hasSendTopChanged[step-1]) {
-            MPI_Isend(localCurrentGrid + width, width, MPI_UNSIGNED_CHAR, prevRank, 0,
-                    MPI_COMM_WORLD, &sendTopRequest);
-        }
-        
-        if (step == 0 || hasSendBottomChanged[step-1]) {
-            MPI_Isend(localCurrentGrid + localHeight * width, width, MPI_UNSIGNED_CHAR, nextRank, 1,
-                    MPI_COMM_WORLD, &sendBottomRequest);
-        }
-        
-        // Получение строк-призраков
-        MPI_Irecv(localCurrentGrid, width, MPI_UNSIGNED_CHAR, prevRank, 1,
-                MPI_COMM_WORLD, &recvTopRequest);
-        
-        MPI_Irecv(localCurrentGrid + (localHeight + 1) * width, width, MPI_UNSIGNED_CHAR, nextRank, 0,
-                MPI_COMM_WORLD, &recvBottomRequest);
-        
-        // Ожидание завершения всех передач данных
-        MPI_Wait(&recvTopRequest, MPI_STATUS_IGNORE);
-        MPI_Wait(&recvBottomRequest, MPI_STATUS_IGNORE);
-        
-        if (step > 0 && hasSendTopChanged[step-1]) {
-            MPI_Wait(&sendTopRequest, MPI_STATUS_IGNORE);
-        }
-        
-        if (step > 0 && hasSendBottomChanged[step-1]) {
-            MPI_Wait(&sendBottomRequest, MPI_STATUS_IGNORE);
-        }
+        // Обмен верхней и нижней границами с соседними процессами. Обмен
+        // идет на каждом шаге: строки-призраки лежат в буфере, который
+        // меняется местами с соседним, и пропуск пересылки оставил бы в нем
+        // строку двухшаговой давности, а сосед ждал бы сообщение напрасно.
+        haloExchange(&halo, localCurrentGrid, step);
         
         // Вычисление следующего поколения для локальной области
         computeNextGeneration(localCurrentGrid, localNextGrid, width, localBufferHeight, 1, localHeight + 1);
-        
-        // Проверка, изменилась ли локальная область
-        hasLocalAreaChanged[step] = hasAreaChanged(localCurrentGrid, localNextGrid, width, 1, localHeight + 1);
-        
-        // Проверка изменений верхней и нижней строк для следующей итерации
-        if (step < steps - 1) {
-            hasSendTopChanged[step] = hasAreaChanged(localCurrentGrid, localNextGrid, width, 1, 2);
-            hasSendBottomChanged[step] = hasAreaChanged(localCurrentGrid, localNextGrid, width, localHeight, localHeight + 1);
-        }
+        haloPublish(&halo, step + 1);
         
         // Сбор всего поля в корневом процессе для визуализации (только в демо-режиме)
         if (mode == DEMO_MODE) {
@@ -329,17 +459,14 @@ int main(int argc, char *argv[]) {
         printf("Количество итераций: %d\n", steps);
         printf("Количество процессов MPI: %d\n", size);
         printf("Количество потоков OpenMP на процесс: %d\n", omp_get_max_threads());
+        printf("Обмен границами: %s\n", sharedHalo ? "общая память узла, MPI между узлами" : "MPI");
         printf("Общее время выполнения: %.4f сек\n", elapsedTime);
         printf("Производительность: %.2f миллионов клеток в секунду\n", 
                (double)(width * height * steps) / elapsedTime / 1000000.0);
     }
     
     // Освобождение памяти
-    free(localCurrentGrid);
-    free(localNextGrid);
-    free(hasSendTopChanged);
-    free(hasSendBottomChanged);
-    free(hasLocalAreaChanged);
+    haloFree(&halo);
     
     if (rank == 0) {
         free(currentGrid);
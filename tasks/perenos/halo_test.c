@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+// Сравнение способов обмена граничными значениями (halo) по кольцу процессов:
+//   sendrecv   - два MPI_Sendrecv на шаг, как в исходных решателях
+//   isend      - MPI_Irecv/MPI_Isend создаются заново на каждом шаге
+//   persistent - MPI_Send_init/MPI_Recv_init один раз, MPI_Startall на шаге
+//   partitioned - MPI_Psend_init/MPI_Precv_init (только MPI >= 4)
+//
+// Запуск: mpirun -np 4 ./halo_test [размер сообщения в double] [итерации]
+
+#define WARMUP_ITERATIONS 10  // Количество "разогревающих" итераций
+#define PARTITIONS 4          // Число частей сообщения в режиме partitioned
+
+typedef struct {
+    double *send[2];  // Граничные значения: [0] - левому соседу, [1] - правому
+    double *recv[2];  // Приходящие значения: [0] - от левого, [1] - от правого
+    int count;
+    int left, right;
+} Buffers;
+
+static void step_sendrecv(Buffers *b, MPI_Request *unused) {
+    (void)unused;
+    MPI_Sendrecv(b->send[1], b->count, MPI_DOUBLE, b->right, 0,
+                 b->recv[0], b->count, MPI_DOUBLE, b->left, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(b->send[0], b->count, MPI_DOUBLE, b->left, 1,
+                 b->recv[1], b->count, MPI_DOUBLE, b->right, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+static void step_isend(Buffers *b, MPI_Request *requests) {
+    MPI_Irecv(b->recv[0], b->count, MPI_DOUBLE, b->left, 0, MPI_COMM_WORLD, &requests[0]);
+    MPI_Irecv(b->recv[1], b->count, MPI_DOUBLE, b->right, 1, MPI_COMM_WORLD, &requests[1]);
+    MPI_Isend(b->send[1], b->count, MPI_DOUBLE, b->right, 0, MPI_COMM_WORLD, &requests[2]);
+    MPI_Isend(b->send[0], b->count, MPI_DOUBLE, b->left, 1, MPI_COMM_WORLD, &requests[3]);
+    MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+}
+
+static void setup_persistent(Buffers *b, MPI_Request *requests) {
+    MPI_Recv_init(b->recv[0], b->count, MPI_DOUBLE, b->left, 0, MPI_COMM_WORLD, &requests[0]);
+    MPI_Recv_init(b->recv[1], b->count, MPI_DOUBLE, b->right, 1, MPI_COMM_WORLD, &requests[1]);
+    MPI_Send_init(b->send[1], b->count, MPI_DOUBLE, b->right, 0, MPI_COMM_WORLD, &requests[2]);
+    MPI_Send_init(b->send[0], b->count, MPI_DOUBLE, b->left, 1, MPI_COMM_WORLD, &requests[3]);
+}
+
+static void step_persistent(Buffers *b, MPI_Request *requests) {
+    (void)b;
+    MPI_Startall(4, requests);
+    MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+}
+
+#if MPI_VERSION >= 4
+// Сообщение делится на PARTITIONS частей, каждая помечается готовой через
+// MPI_Pready - так в решателе можно отправлять часть границы, как только
+// её досчитал поток
+static void setup_partitioned(Buffers *b, MPI_Request *requests) {
+    MPI_Count part = b->count / PARTITIONS;
+    MPI_Precv_init(b->recv[0], PARTITIONS, part, MPI_DOUBLE, b->left, 0, MPI_COMM_WORLD,
+                   MPI_INFO_NULL, &requests[0]);
+    MPI_Precv_init(b->recv[1], PARTITIONS, part, MPI_DOUBLE, b->right, 1, MPI_COMM_WORLD,
+                   MPI_INFO_NULL, &requests[1]);
+    MPI_Psend_init(b->send[1], PARTITIONS, part, MPI_DOUBLE, b->right, 0, MPI_COMM_WORLD,
+                   MPI_INFO_NULL, &requests[2]);
+    MPI_Psend_init(b->send[0], PARTITIONS, part, MPI_DOUBLE, b->left, 1, MPI_COMM_WORLD,
+                   MPI_INFO_NULL, &requests[3]);
+}
+
+static void step_partitioned(Buffers *b, MPI_Request *requests) {
+    (void)b;
+    MPI_Startall(4, requests);
+    for (int p = 0; p < PARTITIONS; p++) {
+        MPI_Pready(p, requests[2]);
+        MPI_Pready(p, requests[3]);
+    }
+    MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+}
+#endif
+
+// Измеряет среднее и минимальное время шага, берётся максимум по процессам
+static void measure(const char *name, void (*step)(Buffers *, MPI_Request *), Buffers *b,
+                    MPI_Request *requests, int iterations, int rank, double *avg_out) {
+    double min_time = 1e10, total = 0;
+
+    // Разогрев - выполняем несколько итераций без измерения времени
+    for (int i = 0; i < WARMUP_ITERATIONS; i++) {
+        step(b, requests);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    for (int i = 0; i < iterations; i++) {
+        double start_time = MPI_Wtime();
+        step(b, requests);
+        double elapsed = (MPI_Wtime() - start_time) * 1000000.0; // В микросекундах
+        if (elapsed < min_time) min_time = elapsed;
+        total += elapsed;
+    }
+
+    double avg = total / iterations, global_avg, global_min;
+    MPI_Reduce(&avg, &global_avg, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&min_time, &global_min, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("%-12s  мин: %9.2f мкс  среднее: %9.2f мкс\n", name, global_min, global_avg);
+    }
+    *avg_out = global_avg;
+}
+
+int main(int argc, char *argv[]) {
+    int rank, size;
+
+    // Инициализация MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int count = (argc > 1) ? atoi(argv[1]) : 1;
+    int iterations = (argc > 2) ? atoi(argv[2]) : 10000;
+    if (count < 1 || iterations < 1) {
+        if (rank == 0) {
+            printf("Использование: %s [размер сообщения в double] [итерации]\n", argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Соседи по кольцу, у крайних процессов решателя обмен односторонний,
+    // здесь кольцо даёт одинаковую нагрузку на все процессы
+    Buffers b;
+    b.count = count;
+    b.left = (rank - 1 + size) % size;
+    b.right = (rank + 1) % size;
+    for (int i = 0; i < 2; i++) {
+        b.send[i] = (double*)malloc(count * sizeof(double));
+        b.recv[i] = (double*)malloc(count * sizeof(double));
+        for (int j = 0; j < count; j++) {
+            b.send[i][j] = rank + j;
+        }
+    }
+
+    if (rank == 0) {
+        printf("Обмен halo по кольцу: %d процессов, %d double в сообщении, %d итераций\n",
+               size, count, iterations);
+    }
+
+    MPI_Request requests[4];
+    double t_sendrecv, t_isend, t_persistent;
+
+    measure("sendrecv", step_sendrecv, &b, requests, iterations, rank, &t_sendrecv);
+    measure("isend", step_isend, &b, requests, iterations, rank, &t_isend);
+
+    setup_persistent(&b, requests);
+    measure("persistent", step_persistent, &b, requests, iterations, rank, &t_persistent);
+    for (int i = 0; i < 4; i++) {
+        MPI_Request_free(&requests[i]);
+    }
+
+#if MPI_VERSION >= 4
+    if (count % PARTITIONS == 0) {
+        double t_partitioned;
+        setup_partitioned(&b, requests);
+        measure("partitioned", step_partitioned, &b, requests, iterations, rank, &t_partitioned);
+        for (int i = 0; i < 4; i++) {
+            MPI_Request_free(&requests[i]);
+        }
+    } else if (rank == 0) {
+        printf("partitioned   пропущен: размер не делится на %d\n", PARTITIONS);
+    }
+#else
+    if (rank == 0) {
+        printf("partitioned   недоступен: библиотека реализует MPI %d.%d\n", MPI_VERSION, MPI_SUBVERSION);
+    }
+#endif
+
+    // Проверка: после обмена от левого соседа пришли его значения
+    int ok = (b.recv[0][0] == b.left) && (b.recv[1][0] == b.right);
+    int all_ok;
+    MPI_Reduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, 0, MPI_COMM_WORLD);
+
+    // Выводим результаты
+    if (rank == 0) {
+        printf("Экономия persistent относительно isend: %.2f мкс на шаг (%.1f%%)\n",
+               t_isend - t_persistent, 100.0 * (t_isend - t_persistent) / t_isend);
+        printf("Экономия persistent относительно sendrecv: %.2f мкс на шаг (%.1f%%)\n",
+               t_sendrecv - t_persistent, 100.0 * (t_sendrecv - t_persistent) / t_sendrecv);
+        printf("Проверка данных: %s\n", all_ok ? "OK" : "ОШИБКА");
+    }
+
+    for (int i = 0; i < 2; i++) {
+        free(b.send[i]);
+        free(b.recv[i]);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
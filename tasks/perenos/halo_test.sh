@@ -0,0 +1,9 @@
+#!/bin/sh
+#SBATCH -n 4
+#SBATCH -o Hello-%j.out # STDOUT
+#SBATCH -e Hello-%j.err # STDERR
+
+# Размеры сообщения: одно значение (как в решателях) и большие границы
+for count in 1 64 4096; do
+    mpirun -np 4 ./halo_test $count
+done
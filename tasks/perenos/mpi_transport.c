@@ -1,27 +1,138 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <mpi.h>
 
-// Параметры сетки
-#define T_MAX 1.0     // максимальное время
-#define X_MAX 1.0     // размер расчетной области по x
-#define K 100         // количество шагов по времени
-#define M 100         // количество шагов по пространству
+#include "../../perenos/transport_problem.h"
+#include "../../perenos/transport_stepper.h"
+#include "../../trace/mpi_trace.h"
 
-// Начальное условие u(x,0)
-double initial_condition(double x) {
-    return sin(2.0 * M_PI * x);
+// Параметры задачи (a, T, X, phi, psi, f) задаются при запуске,
+// см. perenos/transport_problem.h
+#define DEFAULT_K 100         // количество шагов по времени
+#define DEFAULT_M 100         // количество шагов по пространству
+
+// Зонды: вместо всей истории u[K+1][M+1] сохраняются только
+//   probe_x=<x>  - ряд u(t) в точке x (каждый probe_every-й слой)
+//   probe_t=<t>  - срез u(x) в момент t (каждая probe_every-я точка)
+// Без зондов в командной строке ставятся u(t) в x=X/2 и u(x) при t=T/2.
+// С адаптивным шагом (cfl=...) номера слоев заранее не известны: ряд
+// растет по ходу счета, а срез берется на ближайшем к t слое.
+#define MAX_PROBES 16
+#define DEFAULT_PROBE_EVERY 5
+
+typedef enum { PROBE_POINT, PROBE_SLICE } ProbeKind;
+
+// Запрос зондов из командной строки (разбирает процесс 0 и рассылает байтами)
+typedef struct {
+    int count;
+    int every;
+    ProbeKind kind[MAX_PROBES];
+    double where[MAX_PROBES];   // x для точки, t для среза
+} ProbeRequest;
+
+typedef struct {
+    ProbeKind kind;
+    int index;        // глобальный индекс точки m или номер слоя k (-1, пока слой не выбран)
+    int owner;        // процесс, которому принадлежит точка (PROBE_POINT)
+    int count;        // число значений в ряду (место под них) / срезе
+    int filled;       // сколько значений ряда уже записано
+    double time;      // момент среза (PROBE_SLICE)
+    double *values;   // ряд у владельца и на процессе 0, срез на процессе 0
+} Probe;
+
+// Точки [start, start+count) процесса p: делятся все M+1 точек,
+// включая правую границу x=X
+void local_range(int M, int size, int p, int *start, int *count) {
+    int base = (M + 1) / size;
+    int rem = (M + 1) % size;
+    *count = base + ((p < rem) ? 1 : 0);
+    *start = p * base + ((p < rem) ? p : rem);
+}
+
+// Количество индексов, кратных every, в [start, start+count)
+int sampled_count(int start, int count, int every) {
+    return (start + count + every - 1) / every - (start + every - 1) / every;
+}
+
+// Отделяет probe_*= от параметров задачи; остальное остается в argv
+int probe_parse_args(ProbeRequest *req, int argc, char **argv, char **rest) {
+    int nrest = 0;
+    req->count = 0;
+    req->every = DEFAULT_PROBE_EVERY;
+
+    for (int i = 0; i < argc; i++) {
+        int point = strncmp(argv[i], "probe_x=", 8) == 0;
+        int slice = strncmp(argv[i], "probe_t=", 8) == 0;
+
+        if (point || slice) {
+            if (req->count == MAX_PROBES) {
+                fprintf(stderr, "Слишком много зондов (не более %d)\n", MAX_PROBES);
+                return -1;
+            }
+            req->kind[req->count] = point ? PROBE_POINT : PROBE_SLICE;
+            req->where[req->count] = atof(argv[i] + 8);
+            req->count++;
+        } else if (strncmp(argv[i], "probe_every=", 12) == 0) {
+            req->every = atoi(argv[i] + 12);
+            if (req->every < 1) {
+                fprintf(stderr, "probe_every должно быть положительным\n");
+                return -1;
+            }
+        } else {
+            rest[nrest++] = argv[i];
+        }
+    }
+    return nrest;
+}
+
+// Запись значений зондов для слоя k; layer - локальные точки без ghost cells
+void probes_sample(Probe *probes, int nprobes, int every, int k, const double *layer,
+                   int start_m, int local_M, int rank, int *recvcounts, int *displs) {
+    for (int p = 0; p < nprobes; p++) {
+        Probe *pr = &probes[p];
+
+        if (pr->kind == PROBE_POINT) {
+            if (rank == pr->owner && k % every == 0) {
+                if (pr->filled == pr->count) {
+                    pr->count *= 2;
+                    pr->values = (double *)realloc(pr->values, pr->count * sizeof(double));
+                }
+                pr->values[pr->filled++] = layer[pr->index - start_m];
+            }
+        } else if (k == pr->index) {
+            // Срез собирается сразу, одним MPI_Gatherv на зонд
+            int first = (start_m + every - 1) / every * every;
+            int n = sampled_count(start_m, local_M, every);
+            double *send = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+            for (int i = 0; i < n; i++) {
+                send[i] = layer[first + i * every - start_m];
+            }
+            MPI_Gatherv(send, n, MPI_DOUBLE, pr->values, recvcounts, displs, MPI_DOUBLE,
+                        0, MPI_COMM_WORLD);
+            free(send);
+        }
+    }
 }
 
-// Граничные условия u(0,t) и u(X_MAX,t)
-double boundary_condition(double t) {
-    return 0.0;
+// Адаптивный шаг: срез берется на первом слое, до момента которого
+// осталось меньше половины шага
+void probes_schedule(Probe *probes, int nprobes, int k, double t, double tau) {
+    for (int p = 0; p < nprobes; p++) {
+        Probe *pr = &probes[p];
+        if (pr->kind == PROBE_SLICE && pr->index < 0 && t >= pr->time - 0.5 * tau) {
+            pr->index = k;
+            pr->time = t;
+        }
+    }
 }
 
-// Функция источника f(x,t)
-double source_function(double x, double t) {
-    return 0.0;
+// Максимальная скорость по всем процессам, чтобы шаг у всех совпадал
+double allreduce_max(double local) {
+    double global;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return global;
 }
 
 int main(int argc, char **argv) {
@@ -30,183 +141,341 @@ int main(int argc, char **argv) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
+    // Параметры задачи и зондов разбирает процесс 0 и рассылает остальным
+    TransportConfig cfg;
+    ProbeRequest req;
+    const char *positional[] = {"K", "M", NULL};
+    if (rank == 0) {
+        char **rest = (char **)malloc(argc * sizeof(char *));
+        int nrest = probe_parse_args(&req, argc, argv, rest);
+
+        problem_defaults(&cfg, DEFAULT_K, DEFAULT_M);
+        cfg.phi = PHI_SINE;  // u(0,x) = sin(2*pi*x)
+        if (nrest < 0 || problem_parse_args(&cfg, nrest, rest, positional) != 0) {
+            printf("Использование: %s [K M] [ключ=значение ...] [config=файл] "
+                   "[probe_x=x ...] [probe_t=t ...] [probe_every=n]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (cfg.scheme != SCHEME_CROSS) {
+            printf("Здесь реализована только схема \"крест\" (scheme=cross), "
+                   "остальные схемы - в perenos/parr_test_full.c\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        problem_print(&cfg);
+        free(rest);
+    }
+    MPI_Bcast(&cfg, sizeof(cfg), MPI_BYTE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&req, sizeof(req), MPI_BYTE, 0, MPI_COMM_WORLD);
+    int K = cfg.K, M = cfg.M;
+    int adaptive = cfg.cfl > 0.0;
+
     // Шаги сетки
-    double tau = T_MAX / K;  // шаг по времени
-    double h = X_MAX / M;    // шаг по пространству
-    
-    // Расчет локальных границ для каждого процесса
-    int local_M = M / size;
-    if (rank < M % size) local_M++;
-    
-    // Определение глобальных индексов начала и конца для каждого процесса
-    int start_m = 0;
-    int tmp = 0;
-    for (int i = 0; i < rank; i++) {
-        tmp = M / size;
-        if (i < M % size) tmp++;
-        start_m += tmp;
-    }
-    int end_m = start_m + local_M - 1;
-    
-    // Выделение памяти для трех временных слоев с учетом ghost cells
-    double **u = (double **)malloc((K+1) * sizeof(double *));
-    for (int k = 0; k <= K; k++) {
-        u[k] = (double *)malloc((local_M+2) * sizeof(double)); // +2 для ghost cells
-    }
-    
+    double tau = cfg.t_max / K;  // шаг по времени (при постоянном шаге)
+    double h = cfg.x_max / M;    // шаг по пространству
+
+    // Условие устойчивости схемы "крест": max|a| * tau / h <= 1
+    double courant_max = fabs(cfg.a) * tau / h * (1.0 + fabs(cfg.a_amp));
+    if (rank == 0) {
+        if (!adaptive && courant_max > 1.0) {
+            printf("Warning: Stability condition not satisfied (|A|*tau/h = %f)\n", courant_max);
+        }
+        if (adaptive && cfg.cfl > 1.0) {
+            printf("Warning: cfl=%g is above the stability limit 1 of scheme cross\n", cfg.cfl);
+        }
+    }
+
+    // Шаг по времени выбирается так же, как в perenos/parr_test_full.c
+    TimeStepper step;
+    stepper_init(&step, &cfg, h, 1, adaptive, allreduce_max);
+
+    // Граничные значения на всех временных слоях (только при постоянном шаге)
+    double *psi_table = adaptive ? NULL : problem_tabulate_psi(&cfg, tau);
+
+    // Локальный участок сетки
+    int start_m, local_M;
+    local_range(M, size, rank, &start_m, &local_M);
+
+    // Зонды по умолчанию: середина отрезка и середина интервала времени
+    int every = req.every;
+    Probe probes[MAX_PROBES];
+    int nprobes = (req.count > 0) ? req.count : 2;
+    for (int p = 0; p < nprobes; p++) {
+        Probe *pr = &probes[p];
+        double where;
+        if (req.count > 0) {
+            pr->kind = req.kind[p];
+            where = req.where[p];
+            double scaled = (pr->kind == PROBE_POINT) ? where / h : where / tau;
+            pr->index = (int)lround(scaled);
+        } else {
+            pr->kind = (p == 0) ? PROBE_POINT : PROBE_SLICE;
+            where = 0.5 * cfg.t_max;
+            pr->index = (p == 0) ? M / 2 : K / 2;
+        }
+        int limit = (pr->kind == PROBE_POINT) ? M : K;
+        if (pr->index < 0) pr->index = 0;
+        if (pr->index > limit) pr->index = limit;
+        pr->time = pr->index * tau;
+        if (adaptive && pr->kind == PROBE_SLICE) {
+            pr->index = -1;
+            pr->time = fmin(fmax(where, 0.0), cfg.t_max);
+        }
+
+        pr->filled = 0;
+        pr->owner = 0;
+        if (pr->kind == PROBE_POINT) {
+            for (int q = 0; q < size; q++) {
+                int s, n;
+                local_range(M, size, q, &s, &n);
+                if (pr->index >= s && pr->index < s + n) pr->owner = q;
+            }
+            pr->count = adaptive ? 64 : K / every + 1;
+        } else {
+            pr->count = M / every + 1;
+        }
+        int keeps = (rank == 0) || (pr->kind == PROBE_POINT && rank == pr->owner);
+        pr->values = keeps ? (double *)malloc(pr->count * sizeof(double)) : NULL;
+    }
+
+    // Раскладка срезов по процессам для MPI_Gatherv
+    int *recvcounts = NULL, *displs = NULL;
+    if (rank == 0) {
+        recvcounts = (int *)malloc(size * sizeof(int));
+        displs = (int *)malloc(size * sizeof(int));
+        for (int q = 0; q < size; q++) {
+            int s, n;
+            local_range(M, size, q, &s, &n);
+            recvcounts[q] = sampled_count(s, n, every);
+            displs[q] = (q == 0) ? 0 : displs[q-1] + recvcounts[q-1];
+        }
+    }
+
+    // Три временных слоя с ghost cells: O(M/p) памяти при любом K
+    double *u_prev = (double *)calloc(local_M+2, sizeof(double));
+    double *u_curr = (double *)calloc(local_M+2, sizeof(double));
+    double *u_next = (double *)calloc(local_M+2, sizeof(double));
+
+    // Моменты слоев, попавших в ряды точечных зондов (на процессе 0)
+    int times_count = 0, times_capacity = adaptive ? 64 : K / every + 1;
+    double *sample_times = (rank == 0) ? (double *)malloc(times_capacity * sizeof(double)) : NULL;
+
     // Заполнение начальных условий для k=0
     for (int i = 0; i <= local_M+1; i++) {
         int m = start_m + i - 1; // Глобальный индекс с учетом ghost cells
-        
+
         if (m >= 0 && m <= M) {
             double x = m * h;
-            u[0][i] = initial_condition(x);
+            u_curr[i] = problem_phi(&cfg, x);
         }
     }
-    
-    // Используем схему первого порядка для вычисления k=1
-    for (int i = 1; i <= local_M; i++) {
-        int m = start_m + i - 1; // Глобальный индекс без ghost cells
-        
-        if (m > 0 && m < M) {
-            double x = m * h;
-            u[1][i] = u[0][i] + tau * (-(u[0][i+1] - u[0][i-1])/(2*h) + source_function(x, 0));
-        } else {
-            // Граничные условия для k=1
-            u[1][i] = boundary_condition(tau);
-        }
+    if (adaptive) {
+        probes_schedule(probes, nprobes, 0, 0.0, 0.0);
+    }
+    probes_sample(probes, nprobes, every, 0, &u_curr[1], start_m, local_M, rank, recvcounts, displs);
+    if (rank == 0) {
+        sample_times[times_count++] = 0.0;
     }
-    
-    // Основной цикл по времени
-    for (int k = 1; k < K; k++) {
+
+    // Стационарный источник вычисляется один раз в каждой точке
+    double *source = NULL;
+    if (problem_source_is_steady(&cfg)) {
+        source = (double *)malloc((local_M+2) * sizeof(double));
+        problem_tabulate_source(&cfg, start_m - 1, local_M+2, h, source);
+    }
+
+    // Основной цикл по времени: слой k в момент t -> слой k+1 в момент t + tau.
+    // Схеме "крест" нужен слой t - tau: при k=0 и при росте шага она заново
+    // стартует со схемы первого порядка, при уменьшении шага этот слой
+    // интерполируется между двумя хранимыми.
+    for (; !stepper_done(&step); stepper_advance(&step)) {
+        int k = step.k;
+
         // Обмен ghost cells между процессами
-        double send_left = u[k][1];
-        double send_right = u[k][local_M];
+        trace_begin("halo");
+        double send_left = u_curr[1];
+        double send_right = u_curr[local_M];
         double recv_left = 0.0, recv_right = 0.0;
-        
+
         MPI_Status status;
-        
+
         // Отправка вправо, прием слева
         if (rank > 0) {
             MPI_Sendrecv(&send_left, 1, MPI_DOUBLE, rank-1, 0,
                          &recv_left, 1, MPI_DOUBLE, rank-1, 0,
                          MPI_COMM_WORLD, &status);
-            u[k][0] = recv_left;
+            u_curr[0] = recv_left;
         } else {
             // Граничное условие для левой границы
-            u[k][0] = boundary_condition(k * tau);
+            u_curr[0] = psi_table ? psi_table[k] : problem_psi(&cfg, step.t);
         }
-        
+
         // Отправка влево, прием справа
         if (rank < size - 1) {
             MPI_Sendrecv(&send_right, 1, MPI_DOUBLE, rank+1, 0,
                          &recv_right, 1, MPI_DOUBLE, rank+1, 0,
                          MPI_COMM_WORLD, &status);
-            u[k][local_M+1] = recv_right;
-        } else {
-            // Граничное условие для правой границы
-            u[k][local_M+1] = boundary_condition(k * tau);
+            u_curr[local_M+1] = recv_right;
         }
-        
-        // Вычисление следующего временного слоя по схеме "крест"
-        for (int i = 1; i <= local_M; i++) {
-            int m = start_m + i - 1; // Глобальный индекс
-            
-            if (m > 0 && m < M) {
-                double x = m * h;
-                double t = k * tau;
-                
-                // Схема "крест"
-                u[k+1][i] = u[k-1][i] - (tau/h) * (u[k][i+1] - u[k][i-1]) + 
-                             2 * tau * source_function(x, t);
-            } else {
-                // Граничное условие
-                u[k+1][i] = boundary_condition((k+1) * tau);
+        // У последнего процесса правый ghost не нужен: точка x=X
+        // вычисляется из соседней, а не по схеме
+        trace_end();
+
+        stepper_next(&step, &cfg);
+        double t = step.t;
+        tau = step.tau;
+        double t_next = adaptive ? t + tau : (k + 1) * tau;
+        double psi_next = psi_table ? psi_table[k+1] : problem_psi(&cfg, t_next);
+
+        if (step.restart && k > 0 && step.ratio < 1.0) {
+            for (int i = 0; i <= local_M+1; i++) {
+                u_prev[i] = u_curr[i] + step.ratio * (u_prev[i] - u_curr[i]);
             }
+            step.restart = 0;
         }
-    }
-    
-    // Сбор результатов на процессе с rank=0 для вывода
-    if (rank == 0) {
-        // Буфер для хранения всех результатов
-        double **global_u = (double **)malloc((K+1) * sizeof(double *));
-        for (int k = 0; k <= K; k++) {
-            global_u[k] = (double *)malloc((M+1) * sizeof(double));
-            
-            // Копирование локальных данных процесса 0
+
+        // Вычисление следующего временного слоя по схеме "крест"
+        // (при нулевом источнике f не вычисляется вовсе)
+        trace_begin("compute");
+        if (step.restart) {
+            // Схема первого порядка: вперед по времени, центральная по пространству
+            double a = problem_velocity(&cfg, t + 0.5 * tau);
+            for (int i = 1; i <= local_M; i++) {
+                int m = start_m + i - 1; // Глобальный индекс без ghost cells
+
+                if (m > 0 && m < M) {
+                    double x = m * h;
+                    double fm = source ? source[i] : problem_f(&cfg, t, x);
+                    u_next[i] = u_curr[i] + tau * (-a * (u_curr[i+1] - u_curr[i-1])/(2*h) + fm);
+                } else if (m == 0) {
+                    u_next[i] = psi_next;
+                } else {
+                    // Справа нулевая производная (снос), как в perenos/seq_test.c
+                    u_next[i] = u_next[i-1];
+                }
+            }
+        } else {
+            double c = problem_velocity(&cfg, t) * tau / h;  // число Куранта
             for (int i = 1; i <= local_M; i++) {
-                int m = start_m + i - 1;
-                global_u[k][m] = u[k][i];
+                int m = start_m + i - 1; // Глобальный индекс
+
+                if (m > 0 && m < M) {
+                    // Схема "крест"
+                    u_next[i] = u_prev[i] - c * (u_curr[i+1] - u_curr[i-1]);
+                    if (cfg.f != SOURCE_ZERO) {
+                        u_next[i] += 2 * tau * (source ? source[i] : problem_f(&cfg, t, m * h));
+                    }
+                } else if (m == 0) {
+                    // Граничное условие слева
+                    u_next[i] = psi_next;
+                } else {
+                    // Нулевая производная на правой границе
+                    u_next[i] = u_next[i-1];
+                }
             }
         }
-        
-        // Получение данных от других процессов
-        for (int p = 1; p < size; p++) {
-            int p_local_M = M / size;
-            if (p < M % size) p_local_M++;
-            
-            int p_start_m = 0;
-            int tmp = 0;
-            for (int i = 0; i < p; i++) {
-                tmp = M / size;
-                if (i < M % size) tmp++;
-                p_start_m += tmp;
+        trace_end();
+
+        trace_begin("gather");
+        if (adaptive) {
+            probes_schedule(probes, nprobes, k + 1, t_next, tau);
+        }
+        probes_sample(probes, nprobes, every, k + 1, &u_next[1], start_m, local_M, rank, recvcounts, displs);
+        if (rank == 0 && (k + 1) % every == 0) {
+            if (times_count == times_capacity) {
+                times_capacity *= 2;
+                sample_times = (double *)realloc(sample_times, times_capacity * sizeof(double));
             }
-            
-            // Получение данных для каждого временного слоя
-            for (int k = 0; k <= K; k++) {
-                double *buffer = (double *)malloc(p_local_M * sizeof(double));
-                MPI_Recv(buffer, p_local_M, MPI_DOUBLE, p, k, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                
-                // Копирование данных в глобальный массив
-                for (int i = 0; i < p_local_M; i++) {
-                    int m = p_start_m + i;
-                    global_u[k][m] = buffer[i];
-                }
-                free(buffer);
+            sample_times[times_count++] = t_next;
+        }
+        trace_end();
+
+        // Сдвиг слоев (prev <- curr <- next)
+        double *temp = u_prev;
+        u_prev = u_curr;
+        u_curr = u_next;
+        u_next = temp;
+    }
+
+    double t_final = step.t;
+    K = step.k;
+    if (rank == 0 && adaptive) {
+        printf("Adaptive step: %d steps, %d restarts, tau %.4e .. %.4e (cfl %g)\n",
+               K, step.restarts, step.tau_min, step.tau_max, cfg.cfl);
+    }
+
+    // Погрешность относительно точного решения на последнем слое
+    double err_local[2] = {0.0, 0.0};   // сумма квадратов, максимум
+    int have_exact = problem_error(&cfg, t_final, start_m, local_M, h, &u_curr[1],
+                                   &err_local[0], &err_local[1]);
+    double err_sq = 0.0, err_max = 0.0;
+    MPI_Reduce(&err_local[0], &err_sq, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&err_local[1], &err_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        if (have_exact) {
+            printf("Error at t=%g: L2=%.10e Linf=%.10e\n", t_final, sqrt(h * err_sq), err_max);
+        } else {
+            printf("Error at t=%g: no exact solution for this problem\n", t_final);
+        }
+    }
+
+    // Ряды точечных зондов: одно сообщение на зонд от его владельца.
+    // Длину ряда (K/every + 1) все процессы знают по общему числу шагов
+    for (int p = 0; p < nprobes; p++) {
+        Probe *pr = &probes[p];
+        if (pr->kind != PROBE_POINT) {
+            continue;
+        }
+        int n = K / every + 1;
+        if (rank == 0 && pr->count < n) {
+            pr->values = (double *)realloc(pr->values, n * sizeof(double));
+        }
+        pr->count = n;
+        if (pr->owner == 0) {
+            continue;
+        }
+        if (rank == pr->owner) {
+            MPI_Send(pr->values, pr->count, MPI_DOUBLE, 0, p, MPI_COMM_WORLD);
+        } else if (rank == 0) {
+            MPI_Recv(pr->values, pr->count, MPI_DOUBLE, pr->owner, p, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+    }
+
+    // Вывод: сначала ряды u(t), затем срезы u(x)
+    if (rank == 0) {
+        int printed = 0;
+        for (int p = 0; p < nprobes; p++) {
+            Probe *pr = &probes[p];
+            if (pr->kind != PROBE_POINT) continue;
+
+            printf("%sЗависимость u(t) в точке x=%.3f:\n", printed++ ? "\n" : "", pr->index * h);
+            for (int s = 0; s < pr->count; s++) {
+                printf("t=%.3f, u=%.6f\n", sample_times[s], pr->values[s]);
             }
         }
-        
-        // Вывод зависимости u(t) в точке x=X_MAX/2
-        int middle_x = M/2;
-        printf("Зависимость u(t) в точке x=%.3f:\n", middle_x * h);
-        for (int k = 0; k <= K; k += 5) {  // Выводим каждые 5 временных шагов
-            printf("t=%.3f, u=%.6f\n", k * tau, global_u[k][middle_x]);
-        }
-        
-        // Вывод зависимости u(x) при t=T_MAX/2
-        int middle_t = K/2;
-        printf("\nЗависимость u(x) при t=%.3f:\n", middle_t * tau);
-        for (int m = 0; m <= M; m += 5) {  // Выводим каждые 5 пространственных шагов
-            printf("x=%.3f, u=%.6f\n", m * h, global_u[middle_t][m]);
-        }
-        
-        // Освобождение памяти
-        for (int k = 0; k <= K; k++) {
-            free(global_u[k]);
-        }
-        free(global_u);
-    } else {
-        // Отправка результатов на процесс с rank=0
-        for (int k = 0; k <= K; k++) {
-            // Копирование данных без ghost cells в буфер
-            double *buffer = (double *)malloc(local_M * sizeof(double));
-            for (int i = 0; i < local_M; i++) {
-                buffer[i] = u[k][i+1];
+        for (int p = 0; p < nprobes; p++) {
+            Probe *pr = &probes[p];
+            if (pr->kind != PROBE_SLICE) continue;
+
+            printf("%sЗависимость u(x) при t=%.3f:\n", printed++ ? "\n" : "", pr->time);
+            for (int s = 0; s < pr->count; s++) {
+                printf("x=%.3f, u=%.6f\n", s * every * h, pr->values[s]);
             }
-            
-            // Отправка буфера
-            MPI_Send(buffer, local_M, MPI_DOUBLE, 0, k, MPI_COMM_WORLD);
-            free(buffer);
         }
     }
-    
+
     // Освобождение памяти
-    for (int k = 0; k <= K; k++) {
-        free(u[k]);
+    for (int p = 0; p < nprobes; p++) {
+        free(probes[p].values);
     }
-    free(u);
-    
+    free(sample_times);
+    free(recvcounts);
+    free(displs);
+    free(u_prev);
+    free(u_curr);
+    free(u_next);
+    free(source);
+    free(psi_table);
+
     MPI_Finalize();
     return 0;
 }
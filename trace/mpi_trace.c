@@ -0,0 +1,436 @@
+// PMPI wrappers and region timers, see mpi_trace.h
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#ifndef MPI_TRACE
+#define MPI_TRACE
+#endif
+#include "mpi_trace.h"
+
+#define TRACE_MAX_NAMES 128
+#define TRACE_NAME_LEN 32
+#define TRACE_MAX_DEPTH 32
+#define TRACE_BUCKETS 32          // duration buckets [2^b, 2^(b+1)) us, the first one from 0
+#define TRACE_DEFAULT_EVENTS (1 << 20)
+#define TRACE_CHUNK 65536         // events per message when merging
+
+// One timeline entry; also the wire format of the merge
+typedef struct {
+    double start;       // seconds since the common start
+    double end;
+    long long bytes;    // payload of the call, 0 for regions
+    int name;           // index into the name table
+    int depth;          // region nesting level, MPI calls use the current one
+} TraceEvent;
+
+typedef struct {
+    char name[TRACE_NAME_LEN];
+    int is_region;
+    long long calls;
+    long long bytes;
+    double total;
+    double min;
+    double max;
+    long long buckets[TRACE_BUCKETS];
+} TraceStat;
+
+static struct {
+    int active;
+    int rank;
+    int size;
+    MPI_Comm comm;      // private copy of MPI_COMM_WORLD for the merge
+    double t0;
+
+    TraceEvent *events;
+    long long nevents;
+    long long capacity;
+    long long dropped;
+
+    TraceStat stats[TRACE_MAX_NAMES];
+    int nnames;
+
+    int stack_name[TRACE_MAX_DEPTH];
+    double stack_start[TRACE_MAX_DEPTH];
+    int depth;
+} trace;
+
+// Set in the thread that initialized MPI, other threads are not traced
+static __thread int trace_thread;
+
+static int trace_name_id(const char *name, int is_region) {
+    for (int i = 0; i < trace.nnames; i++) {
+        if (strncmp(trace.stats[i].name, name, TRACE_NAME_LEN - 1) == 0) {
+            return i;
+        }
+    }
+    if (trace.nnames == TRACE_MAX_NAMES) {
+        return -1;
+    }
+
+    TraceStat *s = &trace.stats[trace.nnames];
+    memset(s, 0, sizeof(*s));
+    strncpy(s->name, name, TRACE_NAME_LEN - 1);
+    s->is_region = is_region;
+    s->min = 1e300;
+    return trace.nnames++;
+}
+
+static int trace_bucket(double seconds) {
+    double us = seconds * 1e6;
+    int b = 0;
+    while (us >= 2.0 && b < TRACE_BUCKETS - 1) {
+        us /= 2.0;
+        b++;
+    }
+    return b;
+}
+
+static void trace_record(int id, double start, double end, long long bytes, int depth) {
+    if (id < 0) {
+        return;
+    }
+
+    TraceStat *s = &trace.stats[id];
+    double d = end - start;
+    s->calls++;
+    s->bytes += bytes;
+    s->total += d;
+    if (d < s->min) s->min = d;
+    if (d > s->max) s->max = d;
+    s->buckets[trace_bucket(d)]++;
+
+    if (trace.nevents == trace.capacity) {
+        trace.dropped++;
+        return;
+    }
+    TraceEvent *e = &trace.events[trace.nevents++];
+    e->start = start - trace.t0;
+    e->end = end - trace.t0;
+    e->bytes = bytes;
+    e->name = id;
+    e->depth = depth;
+}
+
+static long long trace_bytes(int count, MPI_Datatype type) {
+    int size = 0;
+    if (type != MPI_DATATYPE_NULL) {
+        PMPI_Type_size(type, &size);
+    }
+    return (long long)count * size;
+}
+
+// Wraps one intercepted call: times it when the caller is traced
+#define TRACE_CALL(label, bytes, call)                                          \
+    do {                                                                        \
+        if (!trace.active || !trace_thread) {                                   \
+            return call;                                                        \
+        }                                                                       \
+        double t_start_ = PMPI_Wtime();                                         \
+        int rc_ = call;                                                         \
+        trace_record(trace_name_id(label, 0), t_start_, PMPI_Wtime(), (bytes),  \
+                     trace.depth);                                              \
+        return rc_;                                                             \
+    } while (0)
+
+void trace_begin(const char *name) {
+    if (!trace.active || !trace_thread || trace.depth == TRACE_MAX_DEPTH) {
+        return;
+    }
+    trace.stack_name[trace.depth] = trace_name_id(name, 1);
+    trace.stack_start[trace.depth] = PMPI_Wtime();
+    trace.depth++;
+}
+
+void trace_end(void) {
+    if (!trace.active || !trace_thread || trace.depth == 0) {
+        return;
+    }
+    trace.depth--;
+    trace_record(trace.stack_name[trace.depth], trace.stack_start[trace.depth], PMPI_Wtime(), 0,
+                 trace.depth);
+}
+
+static void trace_start(void) {
+    PMPI_Comm_rank(MPI_COMM_WORLD, &trace.rank);
+    PMPI_Comm_size(MPI_COMM_WORLD, &trace.size);
+    // The merge runs on its own communicator so it never matches the
+    // application's messages, whatever tags they use
+    PMPI_Comm_dup(MPI_COMM_WORLD, &trace.comm);
+
+    const char *limit = getenv("MPI_TRACE_EVENTS");
+    trace.capacity = limit ? atoll(limit) : TRACE_DEFAULT_EVENTS;
+    if (trace.capacity < 0) {
+        trace.capacity = 0;
+    }
+    trace.events = (TraceEvent *)malloc((trace.capacity > 0 ? trace.capacity : 1) * sizeof(TraceEvent));
+
+    // Common time origin so the timelines of all ranks line up
+    PMPI_Barrier(trace.comm);
+    trace.t0 = PMPI_Wtime();
+    trace_thread = 1;
+    trace.active = 1;
+}
+
+// Per-rank summary: one line per call / region and its duration histogram
+static void trace_write_histograms(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "mpi_trace_rank%d.txt", trace.rank);
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return;
+    }
+
+    fprintf(fp, "# rank %d of %d, %lld timeline events, %lld dropped\n",
+            trace.rank, trace.size, trace.nevents, trace.dropped);
+    fprintf(fp, "# %-22s %6s %10s %12s %12s %12s %14s\n",
+            "name", "kind", "calls", "total_s", "min_us", "max_us", "bytes");
+    for (int i = 0; i < trace.nnames; i++) {
+        TraceStat *s = &trace.stats[i];
+        if (s->calls == 0) {
+            continue;
+        }
+        fprintf(fp, "%-24s %6s %10lld %12.6f %12.3f %12.3f %14lld\n",
+                s->name, s->is_region ? "region" : "mpi", s->calls, s->total,
+                s->min * 1e6, s->max * 1e6, s->bytes);
+        fprintf(fp, "    us:");
+        for (int b = 0; b < TRACE_BUCKETS; b++) {
+            if (s->buckets[b] > 0) {
+                fprintf(fp, " [%lld,%lld)=%lld", b == 0 ? 0LL : 1LL << b, 1LL << (b + 1), s->buckets[b]);
+            }
+        }
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+}
+
+static void trace_write_events(FILE *fp, int rank, const TraceEvent *events, long long n,
+                               char (*names)[TRACE_NAME_LEN], const int *is_region, int *first) {
+    for (long long i = 0; i < n; i++) {
+        const TraceEvent *e = &events[i];
+        fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%lld,\"depth\":%d}}",
+                *first ? "" : ",", names[e->name], is_region[e->name] ? "region" : "mpi", rank,
+                e->start * 1e6, (e->end - e->start) * 1e6, e->bytes, e->depth);
+        *first = 0;
+    }
+}
+
+// Rank 0 streams the events of every rank into one Chrome trace file, the
+// other ranks send their name table and events in chunks
+static void trace_merge(void) {
+    char names[TRACE_MAX_NAMES][TRACE_NAME_LEN];
+    int is_region[TRACE_MAX_NAMES];
+    int nnames = trace.nnames;
+
+    for (int i = 0; i < nnames; i++) {
+        memcpy(names[i], trace.stats[i].name, TRACE_NAME_LEN);
+        is_region[i] = trace.stats[i].is_region;
+    }
+
+    if (trace.rank != 0) {
+        long long n = trace.nevents;
+        PMPI_Send(&nnames, 1, MPI_INT, 0, 0, trace.comm);
+        PMPI_Send(names, nnames * TRACE_NAME_LEN, MPI_CHAR, 0, 0, trace.comm);
+        PMPI_Send(is_region, nnames, MPI_INT, 0, 0, trace.comm);
+        PMPI_Send(&n, 1, MPI_LONG_LONG, 0, 0, trace.comm);
+        for (long long i = 0; i < n; i += TRACE_CHUNK) {
+            int chunk = (n - i < TRACE_CHUNK) ? (int)(n - i) : TRACE_CHUNK;
+            PMPI_Send(&trace.events[i], chunk * (int)sizeof(TraceEvent), MPI_BYTE, 0, 0, trace.comm);
+        }
+        return;
+    }
+
+    const char *path = getenv("MPI_TRACE_FILE");
+    if (!path) {
+        path = "mpi_trace.json";
+    }
+    FILE *fp = fopen(path, "w");
+    TraceEvent *buffer = (TraceEvent *)malloc(TRACE_CHUNK * sizeof(TraceEvent));
+    int first = 1;
+
+    if (fp) {
+        fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        for (int r = 0; r < trace.size; r++) {
+            fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                    "\"args\":{\"name\":\"rank %d\"}}", first ? "" : ",", r, r);
+            first = 0;
+        }
+        trace_write_events(fp, 0, trace.events, trace.nevents, names, is_region, &first);
+    }
+
+    for (int r = 1; r < trace.size; r++) {
+        long long n;
+        PMPI_Recv(&nnames, 1, MPI_INT, r, 0, trace.comm, MPI_STATUS_IGNORE);
+        PMPI_Recv(names, nnames * TRACE_NAME_LEN, MPI_CHAR, r, 0, trace.comm, MPI_STATUS_IGNORE);
+        PMPI_Recv(is_region, nnames, MPI_INT, r, 0, trace.comm, MPI_STATUS_IGNORE);
+        PMPI_Recv(&n, 1, MPI_LONG_LONG, r, 0, trace.comm, MPI_STATUS_IGNORE);
+        for (long long i = 0; i < n; i += TRACE_CHUNK) {
+            int chunk = (n - i < TRACE_CHUNK) ? (int)(n - i) : TRACE_CHUNK;
+            PMPI_Recv(buffer, chunk * (int)sizeof(TraceEvent), MPI_BYTE, r, 0, trace.comm,
+                      MPI_STATUS_IGNORE);
+            if (fp) {
+                trace_write_events(fp, r, buffer, chunk, names, is_region, &first);
+            }
+        }
+    }
+
+    if (fp) {
+        fprintf(fp, "\n]}\n");
+        fclose(fp);
+        printf("MPI trace saved to %s\n", path);
+    }
+    free(buffer);
+}
+
+// ---- Intercepted calls ----
+
+int MPI_Init(int *argc, char ***argv) {
+    int rc = PMPI_Init(argc, argv);
+    trace_start();
+    return rc;
+}
+
+int MPI_Init_thread(int *argc, char ***argv, int required, int *provided) {
+    int rc = PMPI_Init_thread(argc, argv, required, provided);
+    trace_start();
+    return rc;
+}
+
+int MPI_Finalize(void) {
+    if (trace.active && trace_thread) {
+        while (trace.depth > 0) {
+            trace_end();
+        }
+        trace.active = 0;
+        trace_write_histograms();
+        trace_merge();
+        PMPI_Comm_free(&trace.comm);
+        free(trace.events);
+    }
+    return PMPI_Finalize();
+}
+
+int MPI_Send(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+    TRACE_CALL("MPI_Send", trace_bytes(count, type), PMPI_Send(buf, count, type, dest, tag, comm));
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm,
+             MPI_Status *status) {
+    TRACE_CALL("MPI_Recv", trace_bytes(count, type), PMPI_Recv(buf, count, type, source, tag, comm, status));
+}
+
+int MPI_Sendrecv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag,
+                 void *recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag,
+                 MPI_Comm comm, MPI_Status *status) {
+    TRACE_CALL("MPI_Sendrecv", trace_bytes(sendcount, sendtype) + trace_bytes(recvcount, recvtype),
+               PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag, recvbuf, recvcount, recvtype,
+                             source, recvtag, comm, status));
+}
+
+int MPI_Isend(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm,
+              MPI_Request *request) {
+    TRACE_CALL("MPI_Isend", trace_bytes(count, type), PMPI_Isend(buf, count, type, dest, tag, comm, request));
+}
+
+int MPI_Irecv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm,
+              MPI_Request *request) {
+    TRACE_CALL("MPI_Irecv", trace_bytes(count, type), PMPI_Irecv(buf, count, type, source, tag, comm, request));
+}
+
+int MPI_Wait(MPI_Request *request, MPI_Status *status) {
+    TRACE_CALL("MPI_Wait", 0, PMPI_Wait(request, status));
+}
+
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[]) {
+    TRACE_CALL("MPI_Waitall", 0, PMPI_Waitall(count, requests, statuses));
+}
+
+int MPI_Waitany(int count, MPI_Request requests[], int *index, MPI_Status *status) {
+    TRACE_CALL("MPI_Waitany", 0, PMPI_Waitany(count, requests, index, status));
+}
+
+int MPI_Start(MPI_Request *request) {
+    TRACE_CALL("MPI_Start", 0, PMPI_Start(request));
+}
+
+int MPI_Startall(int count, MPI_Request requests[]) {
+    TRACE_CALL("MPI_Startall", 0, PMPI_Startall(count, requests));
+}
+
+int MPI_Test(MPI_Request *request, int *flag, MPI_Status *status) {
+    TRACE_CALL("MPI_Test", 0, PMPI_Test(request, flag, status));
+}
+
+int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status *status) {
+    TRACE_CALL("MPI_Probe", 0, PMPI_Probe(source, tag, comm, status));
+}
+
+int MPI_Iprobe(int source, int tag, MPI_Comm comm, int *flag, MPI_Status *status) {
+    TRACE_CALL("MPI_Iprobe", 0, PMPI_Iprobe(source, tag, comm, flag, status));
+}
+
+int MPI_Barrier(MPI_Comm comm) {
+    TRACE_CALL("MPI_Barrier", 0, PMPI_Barrier(comm));
+}
+
+int MPI_Bcast(void *buf, int count, MPI_Datatype type, int root, MPI_Comm comm) {
+    TRACE_CALL("MPI_Bcast", trace_bytes(count, type), PMPI_Bcast(buf, count, type, root, comm));
+}
+
+int MPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, int root,
+               MPI_Comm comm) {
+    TRACE_CALL("MPI_Reduce", trace_bytes(count, type),
+               PMPI_Reduce(sendbuf, recvbuf, count, type, op, root, comm));
+}
+
+int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op,
+                  MPI_Comm comm) {
+    TRACE_CALL("MPI_Allreduce", trace_bytes(count, type),
+               PMPI_Allreduce(sendbuf, recvbuf, count, type, op, comm));
+}
+
+int MPI_Gather(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+               MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    TRACE_CALL("MPI_Gather", trace_bytes(sendcount, sendtype),
+               PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm));
+}
+
+int MPI_Gatherv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf,
+                const int recvcounts[], const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    TRACE_CALL("MPI_Gatherv", trace_bytes(sendcount, sendtype),
+               PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm));
+}
+
+int MPI_Igatherv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf,
+                 const int recvcounts[], const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm,
+                 MPI_Request *request) {
+    TRACE_CALL("MPI_Igatherv", trace_bytes(sendcount, sendtype),
+               PMPI_Igatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root,
+                             comm, request));
+}
+
+int MPI_Allgather(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                  MPI_Datatype recvtype, MPI_Comm comm) {
+    TRACE_CALL("MPI_Allgather", trace_bytes(sendcount, sendtype),
+               PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm));
+}
+
+int MPI_Fetch_and_op(const void *origin, void *result, MPI_Datatype type, int target_rank,
+                     MPI_Aint target_disp, MPI_Op op, MPI_Win win) {
+    TRACE_CALL("MPI_Fetch_and_op", trace_bytes(1, type),
+               PMPI_Fetch_and_op(origin, result, type, target_rank, target_disp, op, win));
+}
+
+int MPI_File_write_at(MPI_File fh, MPI_Offset offset, const void *buf, int count, MPI_Datatype type,
+                      MPI_Status *status) {
+    TRACE_CALL("MPI_File_write_at", trace_bytes(count, type),
+               PMPI_File_write_at(fh, offset, buf, count, type, status));
+}
+
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf, int count, MPI_Datatype type,
+                          MPI_Status *status) {
+    TRACE_CALL("MPI_File_write_at_all", trace_bytes(count, type),
+               PMPI_File_write_at_all(fh, offset, buf, count, type, status));
+}
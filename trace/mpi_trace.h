@@ -0,0 +1,40 @@
+#ifndef MPI_TRACE_H
+#define MPI_TRACE_H
+
+// Lightweight MPI instrumentation through the PMPI profiling interface
+//
+// Linking mpi_trace.c into a program intercepts its MPI calls (point to
+// point, collectives, waits and MPI-IO writes) and records each one with
+// its duration and payload. Programs can add their own named regions:
+//
+//     trace_begin("halo");
+//     ... exchange ...
+//     trace_end();
+//
+// At MPI_Finalize every rank writes mpi_trace_rank<N>.txt with a
+// duration histogram per call / region, and rank 0 merges the timelines
+// of all ranks into mpi_trace.json (Chrome trace format, open it in
+// chrome://tracing or https://ui.perfetto.dev).
+//
+// Build with tracing:     mpicc -DMPI_TRACE prog.c ../trace/mpi_trace.c -o prog
+// Build without tracing:  mpicc prog.c -o prog   (trace_* compile to nothing)
+//
+// Environment: MPI_TRACE_FILE     merged trace file (default mpi_trace.json)
+//              MPI_TRACE_EVENTS   timeline events kept per rank (default 1048576),
+//                                 histograms keep counting past the limit
+//
+// Only the thread that called MPI_Init is recorded; regions may nest.
+
+#ifdef MPI_TRACE
+
+void trace_begin(const char *name);
+void trace_end(void);
+
+#else
+
+static inline void trace_begin(const char *name) { (void)name; }
+static inline void trace_end(void) {}
+
+#endif
+
+#endif